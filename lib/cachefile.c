@@ -0,0 +1,267 @@
+#include <config.h>
+
+#ident "$Id$"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "prototypes.h"
+#include "defines.h"
+
+/*
+ * Cache files
+ *
+ * A cache file holds the compiled form of a configuration file, in
+ * CACHE_DIR. It starts with a header identifying the source file it was
+ * compiled from (device, inode, size, mtime and ctime, with their
+ * nanoseconds when available). The cache is only used while these still
+ * match the source file, so that it is rebuilt as soon as the source
+ * file is edited or replaced.
+ *
+ * The caches are written by root only, and only trusted if they are
+ * owned by root (or by the effective user) and not writable by others.
+ */
+
+struct cache_header {
+	char magic[8];
+	uint64_t dev;
+	uint64_t ino;
+	uint64_t size;
+	int64_t mtime;
+	int64_t ctime;
+	uint32_t mtime_nsec;
+	uint32_t ctime_nsec;
+	uint64_t len;		/* length of the data following the header */
+};
+
+static void cache_key (struct cache_header *hdr, const char *magic,
+                       const struct stat *src, size_t len)
+{
+	memzero (hdr, sizeof *hdr);
+	memcpy (hdr->magic, magic, strnlen (magic, sizeof hdr->magic));
+	hdr->dev = (uint64_t) src->st_dev;
+	hdr->ino = (uint64_t) src->st_ino;
+	hdr->size = (uint64_t) src->st_size;
+	hdr->mtime = (int64_t) src->st_mtime;
+	hdr->ctime = (int64_t) src->st_ctime;
+#ifdef HAVE_STRUCT_STAT_ST_MTIM
+	hdr->mtime_nsec = (uint32_t) src->st_mtim.tv_nsec;
+	hdr->ctime_nsec = (uint32_t) src->st_ctim.tv_nsec;
+#endif				/* HAVE_STRUCT_STAT_ST_MTIM */
+	hdr->len = (uint64_t) len;
+}
+
+/*
+ * cache_same_file - tell if two stats are of the same version of a file
+ *
+ *	The files are compared like the cache files are compared to their
+ *	source file.
+ */
+bool cache_same_file (const struct stat *sb1, const struct stat *sb2)
+{
+	struct cache_header hdr1, hdr2;
+
+	cache_key (&hdr1, "", sb1, 0);
+	cache_key (&hdr2, "", sb2, 0);
+	return (memcmp (&hdr1, &hdr2, sizeof hdr1) == 0);
+}
+
+/*
+ * cache_buf_add - append data to a growable buffer
+ *
+ *	The buffers are used to build the data of the cache files. An
+ *	empty buffer is { NULL, 0, 0 }, and its data shall be freed.
+ *
+ *	Return 0 on success, -1 on failure (the buffer is left untouched).
+ */
+int cache_buf_add (struct cache_buf *buf, const void *data, size_t len)
+{
+	if (buf->len + len > buf->size) {
+		size_t size = (buf->size + len) * 2;
+		char *tmp = realloc (buf->data, size);
+
+		if (NULL == tmp) {
+			return -1;
+		}
+		buf->data = tmp;
+		buf->size = size;
+	}
+	memcpy (buf->data + buf->len, data, len);
+	buf->len += len;
+	return 0;
+}
+
+/*
+ * cache_buf_add_key - append the key of a source file to a buffer
+ *
+ *	It is the key a cache header holds. The caches compiled from
+ *	several files start their data with the keys of these files.
+ *	A missing file (src is NULL) has a key of its own.
+ *
+ *	Return 0 on success, -1 on failure (the buffer is left untouched).
+ */
+int cache_buf_add_key (struct cache_buf *buf, /*@null@*/const struct stat *src)
+{
+	struct cache_header hdr;
+	struct stat none;
+
+	if (NULL == src) {
+		memzero (&none, sizeof none);
+		src = &none;
+	}
+	cache_key (&hdr, "", src, 0);
+	return cache_buf_add (buf, &hdr, sizeof hdr);
+}
+
+/*
+ * cache_map - map the data of a cache file
+ *
+ *	name is the name of the cache in CACHE_DIR, magic identifies the
+ *	format of the data (at most 8 characters), and src is the stat of
+ *	the source file.
+ *
+ *	Return a pointer to the data and store its length in *len, or
+ *	return NULL if there is no valid cache for src.
+ *	The data shall be released with cache_unmap().
+ */
+/*@null@*/const void *cache_map (const char *name, const char *magic,
+                                 const struct stat *src, size_t *len)
+{
+	char path[1024];
+	struct cache_header key;
+	const struct cache_header *hdr;
+	struct stat sb;
+	void *map;
+	int fd;
+
+	(void) snprintf (path, sizeof path, "%s/%s", CACHE_DIR, name);
+	fd = open (path, O_RDONLY | O_NOCTTY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		return NULL;
+	}
+	if (   (fstat (fd, &sb) != 0)
+	    || !S_ISREG (sb.st_mode)
+	    || ((0 != sb.st_uid) && (geteuid () != sb.st_uid))
+	    || ((sb.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+	    || ((size_t) sb.st_size < sizeof key)) {
+		(void) close (fd);
+		return NULL;
+	}
+
+	map = mmap (NULL, (size_t) sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	(void) close (fd);
+	if (MAP_FAILED == map) {
+		return NULL;
+	}
+
+	hdr = map;
+	cache_key (&key, magic, src, (size_t) sb.st_size - sizeof key);
+	if (memcmp (hdr, &key, sizeof key) != 0) {
+		(void) munmap (map, (size_t) sb.st_size);
+		return NULL;
+	}
+
+	*len = (size_t) hdr->len;
+	return (const char *) map + sizeof key;
+}
+
+/*
+ * cache_unmap - release the data returned by cache_map()
+ */
+void cache_unmap (const void *data, size_t len)
+{
+	(void) munmap ((char *) data - sizeof (struct cache_header),
+	               len + sizeof (struct cache_header));
+}
+
+/*
+ * cache_mkdir - create CACHE_DIR if needed
+ *
+ *	CACHE_DIR is only used if no one but root can write in it, so
+ *	that the files created by root in CACHE_DIR cannot be replaced
+ *	by other users.
+ *
+ *	Return 0 on success, -1 on failure (errno set).
+ */
+int cache_mkdir (void)
+{
+	struct stat sb;
+
+	if ((mkdir (CACHE_DIR, 0755) != 0) && (EEXIST != errno)) {
+		return -1;
+	}
+	if (lstat (CACHE_DIR, &sb) != 0) {
+		return -1;
+	}
+	if (   !S_ISDIR (sb.st_mode)
+	    || (0 != sb.st_uid)
+	    || ((sb.st_mode & (S_IWGRP | S_IWOTH)) != 0)) {
+		errno = EPERM;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * cache_write - write a cache file
+ *
+ *	The cache is replaced atomically. CACHE_DIR is created if needed.
+ *	Nothing is written if the caller is not root.
+ *
+ *	Return 0 on success, -1 on failure (errno set).
+ */
+int cache_write (const char *name, const char *magic,
+                 const struct stat *src, const void *data, size_t len)
+{
+	char path[1024];
+	char tmp[1024];
+	struct cache_header hdr;
+	int fd;
+
+	if (0 != geteuid ()) {
+		errno = EPERM;
+		return -1;
+	}
+
+	if (cache_mkdir () != 0) {
+		return -1;
+	}
+
+	(void) snprintf (path, sizeof path, "%s/%s", CACHE_DIR, name);
+	(void) snprintf (tmp, sizeof tmp, "%s/.%s.XXXXXX", CACHE_DIR, name);
+
+	fd = mkstemp (tmp);
+	if (fd < 0) {
+		return -1;
+	}
+	(void) fcntl (fd, F_SETFD, FD_CLOEXEC);
+
+	cache_key (&hdr, magic, src, len);
+	if (   (write (fd, &hdr, sizeof hdr) != (ssize_t) sizeof hdr)
+	    || (write (fd, data, len) != (ssize_t) len)
+	    || (fchmod (fd, 0644) != 0)) {
+		int saved_errno = errno;
+		(void) close (fd);
+		(void) unlink (tmp);
+		errno = saved_errno;
+		return -1;
+	}
+	if (close (fd) != 0) {
+		(void) unlink (tmp);
+		return -1;
+	}
+
+	if (rename (tmp, path) != 0) {
+		int saved_errno = errno;
+		(void) unlink (tmp);
+		errno = saved_errno;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,271 @@
+#include <config.h>
+
+#ident "$Id$"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "prototypes.h"
+#include "defines.h"
+#include "getdef.h"
+#include "nscd.h"
+#include "sssd.h"
+
+/*
+ * Deferred flushes of the nscd and sssd caches
+ *
+ * Every tool modifying the databases flushes the caches of nscd and
+ * sssd when it exits. When many tools are run in a row (e.g. a script
+ * calling usermod for each user), the caches are flushed again and
+ * again.
+ *
+ * If CACHE_FLUSH_DELAY is set in login.defs, the flushes are deferred by
+ * that many seconds: the requested flushes are recorded in CACHE_DIR
+ * (FLUSH_PENDING), and a background process is started to do them once
+ * the delay expired. The flushes requested by the tools run in the
+ * meantime are merged with the pending ones, so that the caches are
+ * flushed once for the whole burst.
+ */
+#define FLUSH_PENDING	"flush-pending"
+#define FLUSH_GRACE	60	/* after the deadline, the flusher is lost */
+
+#define FLUSH_NSCD_PASSWD	0x01
+#define FLUSH_NSCD_GROUP	0x02
+#define FLUSH_SSSD_PASSWD	0x04
+#define FLUSH_SSSD_GROUP	0x08
+
+struct flush_pending {
+	uint32_t flags;		/* FLUSH_* */
+	int64_t deadline;	/* when the flusher flushes the caches */
+};
+
+static bool flushing = false;	/* the flusher does not defer */
+
+static int flush_lock (int fd, short type)
+{
+	struct flock lk;
+
+	memzero (&lk, sizeof lk);
+	lk.l_type = type;
+	lk.l_whence = SEEK_SET;
+	while (fcntl (fd, F_SETLKW, &lk) != 0) {
+		if (EINTR != errno) {
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ * Open and lock the file of the pending flushes, and read them.
+ *
+ * Return the file descriptor, or -1.
+ */
+static int flush_open (/*@out@*/struct flush_pending *pending)
+{
+	char path[1024];
+	struct stat sb;
+	int fd;
+
+	if (cache_mkdir () != 0) {
+		return -1;
+	}
+	(void) snprintf (path, sizeof path, "%s/%s", CACHE_DIR, FLUSH_PENDING);
+	fd = open (path, O_RDWR | O_CREAT | O_NOCTTY | O_NOFOLLOW | O_CLOEXEC,
+	           0600);
+	if (fd < 0) {
+		return -1;
+	}
+	if (   (fstat (fd, &sb) != 0)
+	    || !S_ISREG (sb.st_mode)
+	    || (0 != sb.st_uid)
+	    || (flush_lock (fd, F_WRLCK) != 0)) {
+		(void) close (fd);
+		return -1;
+	}
+	if (pread (fd, pending, sizeof *pending, 0) != (ssize_t) sizeof *pending) {
+		memzero (pending, sizeof *pending);
+	}
+	return fd;
+}
+
+/*
+ * Write the pending flushes, unlock and close the file.
+ */
+static void flush_close (int fd, const struct flush_pending *pending)
+{
+	(void) pwrite (fd, pending, sizeof *pending, 0);
+	(void) flush_lock (fd, F_UNLCK);
+	(void) close (fd);
+}
+
+/*
+ * The background process: wait for the deadline, and flush the caches
+ * requested until then.
+ */
+static void flusher (unsigned int delay)
+{
+	struct flush_pending pending;
+	uint32_t flags;
+	int sssd_flags = 0;
+	long max_fd;
+	int fd;
+
+	/*
+	 * Do not keep the terminal or the pipes of the caller open while
+	 * waiting.
+	 */
+	(void) setsid ();
+	max_fd = sysconf (_SC_OPEN_MAX);
+	for (fd = STDERR_FILENO + 1; fd < max_fd; fd++) {
+		(void) close (fd);
+	}
+	fd = open ("/dev/null", O_RDWR);
+	if (fd >= 0) {
+		(void) dup2 (fd, STDIN_FILENO);
+		(void) dup2 (fd, STDOUT_FILENO);
+		(void) dup2 (fd, STDERR_FILENO);
+		if (fd > STDERR_FILENO) {
+			(void) close (fd);
+		}
+	}
+
+	(void) sleep (delay);
+
+	fd = flush_open (&pending);
+	if (fd < 0) {
+		_exit (EXIT_FAILURE);
+	}
+	flags = pending.flags;
+	pending.flags = 0;
+	flush_close (fd, &pending);
+
+	flushing = true;
+	if ((flags & FLUSH_NSCD_PASSWD) != 0) {
+		(void) nscd_flush_cache ("passwd");
+	}
+	if ((flags & FLUSH_NSCD_GROUP) != 0) {
+		(void) nscd_flush_cache ("group");
+	}
+	if ((flags & FLUSH_SSSD_PASSWD) != 0) {
+		sssd_flags |= SSSD_DB_PASSWD;
+	}
+	if ((flags & FLUSH_SSSD_GROUP) != 0) {
+		sssd_flags |= SSSD_DB_GROUP;
+	}
+	if (0 != sssd_flags) {
+		(void) sssd_flush_cache (sssd_flags);
+	}
+	_exit (EXIT_SUCCESS);
+}
+
+/*
+ * Record flags in the pending flushes, and start a flusher if there is
+ * none.
+ *
+ * Return true if the flush is deferred, false if the caller shall flush
+ * the cache now.
+ */
+static bool cache_flush_defer (uint32_t flags)
+{
+	struct flush_pending pending;
+	unsigned int delay;
+	time_t now;
+	pid_t pid;
+	int status;
+	int fd;
+
+	if (flushing || (0 != geteuid ())) {
+		return false;
+	}
+	delay = getdef_unum ("CACHE_FLUSH_DELAY", 0);
+	if (0 == delay) {
+		return false;
+	}
+
+	fd = flush_open (&pending);
+	if (fd < 0) {
+		return false;
+	}
+
+	now = time (NULL);
+	if (   (0 != pending.flags)
+	    && (now <= pending.deadline + FLUSH_GRACE)) {
+		/* A flusher will do it */
+		pending.flags |= flags;
+		flush_close (fd, &pending);
+		return true;
+	}
+
+	/*
+	 * Start a new flusher. It is detached from the caller, which
+	 * only waits for the intermediate child.
+	 */
+	pending.flags |= flags;
+	pending.deadline = (int64_t) now + delay;
+	(void) fflush (NULL);
+	pid = fork ();
+	if (0 == pid) {
+		(void) close (fd);
+		pid = fork ();
+		if (0 == pid) {
+			flusher (delay);
+		}
+		_exit ((-1 == pid) ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+	if (   (-1 == pid)
+	    || (waitpid (pid, &status, 0) != pid)
+	    || !WIFEXITED (status)
+	    || (EXIT_SUCCESS != WEXITSTATUS (status))) {
+		/* Flush now; pending flushes are left for the next tool */
+		pending.flags &= ~flags;
+		if (0 == pending.flags) {
+			pending.deadline = 0;
+		}
+		flush_close (fd, &pending);
+		return false;
+	}
+	flush_close (fd, &pending);
+	return true;
+}
+
+/*
+ * cache_flush_defer_nscd - defer a flush of the nscd cache
+ *
+ *	Return true if the flush is deferred, false if the caller shall
+ *	flush the cache of service now.
+ */
+bool cache_flush_defer_nscd (const char *service)
+{
+	if (strcmp (service, "passwd") == 0) {
+		return cache_flush_defer (FLUSH_NSCD_PASSWD);
+	} else if (strcmp (service, "group") == 0) {
+		return cache_flush_defer (FLUSH_NSCD_GROUP);
+	}
+	return false;
+}
+
+/*
+ * cache_flush_defer_sssd - defer a flush of the sssd cache
+ *
+ *	Return true if the flush is deferred, false if the caller shall
+ *	flush the cache now.
+ */
+bool cache_flush_defer_sssd (int dbflags)
+{
+	uint32_t flags = 0;
+
+	if ((dbflags & SSSD_DB_PASSWD) != 0) {
+		flags |= FLUSH_SSSD_PASSWD;
+	}
+	if ((dbflags & SSSD_DB_GROUP) != 0) {
+		flags |= FLUSH_SSSD_GROUP;
+	}
+	return cache_flush_defer (flags);
+}
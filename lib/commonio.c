@@ -74,6 +74,11 @@ static /*@dependent@*/ /*@null@*/struct commonio_entry *next_entry_by_name (
 	struct commonio_db *,
 	/*@null@*/struct commonio_entry *pos,
 	const char *);
+static void free_member_index (struct commonio_db *db);
+static void index_add_entry (struct commonio_db *db,
+                             struct commonio_entry *p);
+static void index_del_entry (struct commonio_db *db,
+                             const struct commonio_entry *p);
 
 static int lock_count = 0;
 static bool nscd_need_reload = false;
@@ -372,6 +377,7 @@ static void free_linked_list (struct commonio_db *db)
 		free (p);
 	}
 	db->tail = NULL;
+	free_member_index (db);
 }
 
 
@@ -427,7 +433,7 @@ cleanup_ENOMEM:
 }
 
 
-int commonio_lock (struct commonio_db *db)
+static int do_commonio_lock (struct commonio_db *db)
 {
 	int i;
 
@@ -490,6 +496,17 @@ int commonio_lock (struct commonio_db *db)
 	return 0;		/* failure */
 }
 
+int commonio_lock (struct commonio_db *db)
+{
+	struct instr_mark mark;
+	int ret;
+
+	instr_begin (&mark, "commonio_lock");
+	ret = do_commonio_lock (db);
+	instr_end (&mark);
+	return ret;
+}
+
 static void dec_lock_count (void)
 {
 	if (lock_count > 0) {
@@ -615,7 +632,7 @@ static void add_one_entry_nis (struct commonio_db *db,
    (for reading very long lines in group files).  */
 #define BUFLEN 4096
 
-int commonio_open (struct commonio_db *db, int mode)
+static int do_commonio_open (struct commonio_db *db, int mode)
 {
 	char *buf;
 	char *cp;
@@ -626,6 +643,7 @@ int commonio_open (struct commonio_db *db, int mode)
 	size_t buflen;
 	int fd;
 	int saved_errno;
+	unsigned long nentries = 0;
 
 	mode &= ~O_CREAT;
 
@@ -738,9 +756,11 @@ int commonio_open (struct commonio_db *db, int mode)
 		p->changed = false;
 
 		add_one_entry (db, p);
+		nentries++;
 	}
 
 	free (buf);
+	instr_count ("commonio_entries", nentries);
 
 	if (ferror (db->fp) != 0) {
 		goto cleanup_errno;
@@ -772,6 +792,17 @@ int commonio_open (struct commonio_db *db, int mode)
 	return 0;
 }
 
+int commonio_open (struct commonio_db *db, int mode)
+{
+	struct instr_mark mark;
+	int ret;
+
+	instr_begin (&mark, "commonio_open");
+	ret = do_commonio_open (db, mode);
+	instr_end (&mark);
+	return ret;
+}
+
 /*
  * Sort given db according to cmp function (usually compares uids)
  */
@@ -858,54 +889,131 @@ commonio_sort (struct commonio_db *db, int (*cmp) (const void *, const void *))
 
 /*
  * Sort entries in db according to order in another.
+ *
+ * The entries of shadow which have a counterpart in passwd are moved
+ * first, in the order of passwd. The other entries follow, in their
+ * original order. If several entries have the same name, they are
+ * matched in order.
+ *
+ * The names of shadow are hashed once, so that this is linear in the
+ * size of both databases.
  */
 int commonio_sort_wrt (struct commonio_db *shadow,
                        const struct commonio_db *passwd)
 {
-	struct commonio_entry *head = NULL, *pw_ptr, *spw_ptr;
-	const char *name;
+	struct commonio_entry **entries, **sorted;
+	struct commonio_entry *pw_ptr, *spw_ptr;
+	size_t *buckets;	/* index + 1 of the first entry, 0 if empty */
+	size_t *same;		/* index + 1 of the next entry with this name */
+	size_t n = 0, nbuckets = 16, nsorted = 0;
+	size_t i;
 
 	if ((NULL == shadow) || (NULL == shadow->head)) {
 		return 0;
 	}
 
-	for (pw_ptr = passwd->head; NULL != pw_ptr; pw_ptr = pw_ptr->next) {
-		if (NULL == pw_ptr->eptr) {
+	for (spw_ptr = shadow->head; NULL != spw_ptr; spw_ptr = spw_ptr->next) {
+		n++;
+	}
+	while (nbuckets < 2 * n) {
+		nbuckets *= 2;
+	}
+
+	entries = malloc (n * sizeof *entries);
+	sorted = malloc (n * sizeof *sorted);
+	same = calloc (n, sizeof *same);
+	buckets = calloc (nbuckets, sizeof *buckets);
+	if (   (NULL == entries) || (NULL == sorted)
+	    || (NULL == same) || (NULL == buckets)) {
+		free (entries);
+		free (sorted);
+		free (same);
+		free (buckets);
+		return -1;
+	}
+
+	/*
+	 * Hash the names of shadow. The entries with the same name are
+	 * chained in same[], in the order of the file.
+	 */
+	for (i = n, spw_ptr = shadow->tail;
+	     NULL != spw_ptr;
+	     spw_ptr = spw_ptr->prev) {
+		const char *name;
+		size_t h;
+
+		i--;
+		entries[i] = spw_ptr;
+		if (NULL == spw_ptr->eptr) {
 			continue;
 		}
-		name = passwd->ops->getname (pw_ptr->eptr);
-		for (spw_ptr = shadow->head;
-		     NULL != spw_ptr;
-		     spw_ptr = spw_ptr->next) {
-			if (NULL == spw_ptr->eptr) {
-				continue;
-			}
-			if (strcmp (name, shadow->ops->getname (spw_ptr->eptr))
+		name = shadow->ops->getname (spw_ptr->eptr);
+		for (h = commonio_hash (name) & (nbuckets - 1);
+		     0 != buckets[h];
+		     h = (h + 1) & (nbuckets - 1)) {
+			if (strcmp (name,
+			            shadow->ops->getname (entries[buckets[h] - 1]->eptr))
 			    == 0) {
+				same[i] = buckets[h];
 				break;
 			}
 		}
-		if (NULL == spw_ptr) {
+		buckets[h] = i + 1;
+	}
+
+	/*
+	 * Take the entries in the order of passwd.
+	 * A taken entry is removed from entries[].
+	 */
+	for (pw_ptr = passwd->head; NULL != pw_ptr; pw_ptr = pw_ptr->next) {
+		const char *name;
+		size_t h;
+
+		if (NULL == pw_ptr->eptr) {
 			continue;
 		}
-		commonio_del_entry (shadow, spw_ptr);
-		spw_ptr->next = head;
-		head = spw_ptr;
+		name = passwd->ops->getname (pw_ptr->eptr);
+		for (h = commonio_hash (name) & (nbuckets - 1);
+		     0 != buckets[h];
+		     h = (h + 1) & (nbuckets - 1)) {
+			size_t first = buckets[h] - 1;
+
+			if (   (NULL != entries[first])
+			    && (strcmp (name,
+			                shadow->ops->getname (entries[first]->eptr))
+			        == 0)) {
+				sorted[nsorted] = entries[first];
+				nsorted++;
+				entries[first] = NULL;
+				if (0 != same[first]) {
+					buckets[h] = same[first];
+				}
+				break;
+			}
+		}
 	}
 
-	for (spw_ptr = head; NULL != spw_ptr; spw_ptr = head) {
-		head = head->next;
-
-		if (NULL != shadow->head) {
-			shadow->head->prev = spw_ptr;
+	/* Then the entries without counterpart */
+	for (i = 0; i < n; i++) {
+		if (NULL != entries[i]) {
+			sorted[nsorted] = entries[i];
+			nsorted++;
 		}
-		spw_ptr->next = shadow->head;
-		shadow->head = spw_ptr;
 	}
 
-	shadow->head->prev = NULL;
+	for (i = 0; i < n; i++) {
+		sorted[i]->prev = (0 != i) ? sorted[i - 1] : NULL;
+		sorted[i]->next = (i + 1 < n) ? sorted[i + 1] : NULL;
+	}
+	shadow->head = sorted[0];
+	shadow->tail = sorted[n - 1];
 	shadow->changed = true;
 
+	free (entries);
+	free (sorted);
+	free (same);
+	free (buckets);
+
 	return 0;
 }
 
@@ -940,11 +1048,12 @@ static int write_all (const struct commonio_db *db)
 }
 
 
-int commonio_close (struct commonio_db *db)
+static int do_commonio_close (struct commonio_db *db)
 {
 	char buf[1024];
 	int errors = 0;
 	struct stat sb;
+	struct instr_mark mark;
 
 	if (!db->isopen) {
 		errno = EINVAL;
@@ -1028,6 +1137,7 @@ int commonio_close (struct commonio_db *db)
 	if (fflush (db->fp) != 0) {
 		errors++;
 	}
+	instr_begin (&mark, "fsync");
 #ifdef HAVE_FSYNC
 	if (fsync (fileno (db->fp)) != 0) {
 		errors++;
@@ -1035,6 +1145,7 @@ int commonio_close (struct commonio_db *db)
 #else				/* !HAVE_FSYNC */
 	sync ();
 #endif				/* !HAVE_FSYNC */
+	instr_end (&mark);
 	if (fclose (db->fp) != 0) {
 		errors++;
 	}
@@ -1066,6 +1177,17 @@ int commonio_close (struct commonio_db *db)
 	return errors == 0;
 }
 
+int commonio_close (struct commonio_db *db)
+{
+	struct instr_mark mark;
+	int ret;
+
+	instr_begin (&mark, "commonio_close");
+	ret = do_commonio_close (db);
+	instr_end (&mark);
+	return ret;
+}
+
 static /*@dependent@*/ /*@null@*/struct commonio_entry *next_entry_by_name (
 	struct commonio_db *db,
 	/*@null@*/struct commonio_entry *pos,
@@ -1117,10 +1239,12 @@ int commonio_update (struct commonio_db *db, const void *eptr)
 			db->ops->free (nentry);
 			return 0;
 		}
+		index_del_entry (db, p);
 		db->ops->free (p->eptr);
 		p->eptr = nentry;
 		p->changed = true;
 		db->cursor = p;
+		index_add_entry (db, p);
 
 		db->changed = true;
 		return 1;
@@ -1142,6 +1266,7 @@ int commonio_update (struct commonio_db *db, const void *eptr)
 #else				/* !KEEP_NIS_AT_END */
 	add_one_entry (db, p);
 #endif				/* !KEEP_NIS_AT_END */
+	index_add_entry (db, p);
 
 	db->changed = true;
 	return 1;
@@ -1174,6 +1299,7 @@ int commonio_append (struct commonio_db *db, const void *eptr)
 	p->line = NULL;
 	p->changed = true;
 	add_one_entry (db, p);
+	index_add_entry (db, p);
 
 	db->changed = true;
 	return 1;
@@ -1182,6 +1308,8 @@ int commonio_append (struct commonio_db *db, const void *eptr)
 
 void commonio_del_entry (struct commonio_db *db, const struct commonio_entry *p)
 {
+	index_del_entry (db, p);
+
 	if (p == db->cursor) {
 		db->cursor = p->next;
 	}
@@ -1306,3 +1434,341 @@ int commonio_rewind (struct commonio_db *db)
 	return NULL;
 }
 
+
+/*
+ * Reverse index from member names to the entries listing them.
+ *
+ * This is only available for databases providing the members operation
+ * (group and gshadow). Once built by commonio_index_members(), it is
+ * kept up to date by commonio_update(), commonio_remove() and
+ * commonio_del_entry(), and freed when the database is closed.
+ *
+ * If the index cannot be maintained (out of memory), it is dropped and
+ * commonio_member_of() falls back to a scan of the database.
+ */
+struct member_postings {
+	/*@owned@*/char *name;
+	/*@dependent@*/struct commonio_entry **entries;
+	size_t n;
+	size_t alloc;
+	/*@owned@*/ /*@null@*/struct member_postings *next;
+};
+
+struct commonio_member_index {
+	/*@owned@*/struct member_postings **buckets;
+	size_t nbuckets;	/* always a power of 2 */
+	size_t count;		/* number of member names */
+};
+
+/*
+ * commonio_hash - hash a name (FNV-1a)
+ */
+size_t commonio_hash (const char *name)
+{
+	size_t h = 2166136261U;
+
+	while ('\0' != *name) {
+		h ^= (unsigned char) *name;
+		h *= 16777619U;
+		name++;
+	}
+	return h;
+}
+
+static void free_member_index (struct commonio_db *db)
+{
+	struct commonio_member_index *idx = db->member_index;
+	size_t i;
+
+	if (NULL == idx) {
+		return;
+	}
+	for (i = 0; i < idx->nbuckets; i++) {
+		while (NULL != idx->buckets[i]) {
+			struct member_postings *mp = idx->buckets[i];
+
+			idx->buckets[i] = mp->next;
+			free (mp->name);
+			free (mp->entries);
+			free (mp);
+		}
+	}
+	free (idx->buckets);
+	free (idx);
+	db->member_index = NULL;
+}
+
+static /*@null@*/struct member_postings *find_postings (
+	const struct commonio_member_index *idx,
+	const char *name)
+{
+	struct member_postings *mp;
+
+	mp = idx->buckets[commonio_hash (name) & (idx->nbuckets - 1)];
+	while ((NULL != mp) && (strcmp (mp->name, name) != 0)) {
+		mp = mp->next;
+	}
+	return mp;
+}
+
+static int grow_member_index (struct commonio_member_index *idx)
+{
+	struct member_postings **buckets;
+	size_t nbuckets = idx->nbuckets * 2;
+	size_t i;
+
+	buckets = (struct member_postings **) calloc (nbuckets,
+	                                              sizeof *buckets);
+	if (NULL == buckets) {
+		return -1;
+	}
+	for (i = 0; i < idx->nbuckets; i++) {
+		while (NULL != idx->buckets[i]) {
+			struct member_postings *mp = idx->buckets[i];
+			size_t b = commonio_hash (mp->name) & (nbuckets - 1);
+
+			idx->buckets[i] = mp->next;
+			mp->next = buckets[b];
+			buckets[b] = mp;
+		}
+	}
+	free (idx->buckets);
+	idx->buckets = buckets;
+	idx->nbuckets = nbuckets;
+	return 0;
+}
+
+static int index_add_member (struct commonio_member_index *idx,
+                             const char *name,
+                             struct commonio_entry *p)
+{
+	struct member_postings *mp;
+	size_t i;
+
+	mp = find_postings (idx, name);
+	if (NULL == mp) {
+		size_t b;
+
+		if (   (idx->count >= idx->nbuckets)
+		    && (grow_member_index (idx) != 0)) {
+			return -1;
+		}
+		mp = (struct member_postings *) calloc (1, sizeof *mp);
+		if (NULL == mp) {
+			return -1;
+		}
+		mp->name = strdup (name);
+		if (NULL == mp->name) {
+			free (mp);
+			return -1;
+		}
+		b = commonio_hash (name) & (idx->nbuckets - 1);
+		mp->next = idx->buckets[b];
+		idx->buckets[b] = mp;
+		idx->count++;
+	}
+
+	/* The name may be listed several times by the same entry */
+	for (i = 0; i < mp->n; i++) {
+		if (mp->entries[i] == p) {
+			return 0;
+		}
+	}
+
+	if (mp->n == mp->alloc) {
+		struct commonio_entry **entries;
+		size_t alloc = (0 == mp->alloc) ? 4 : mp->alloc * 2;
+
+		entries = (struct commonio_entry **)
+		          realloc (mp->entries, alloc * sizeof *entries);
+		if (NULL == entries) {
+			return -1;
+		}
+		mp->entries = entries;
+		mp->alloc = alloc;
+	}
+	mp->entries[mp->n] = p;
+	mp->n++;
+	return 0;
+}
+
+static void index_add_entry (struct commonio_db *db,
+                             struct commonio_entry *p)
+{
+	char *const *list;
+	unsigned int l;
+
+	if ((NULL == db->member_index) || (NULL == p->eptr)) {
+		return;
+	}
+
+	for (l = 0; (list = db->ops->members (p->eptr, l)) != NULL; l++) {
+		for (; NULL != *list; list++) {
+			if (index_add_member (db->member_index, *list, p) != 0) {
+				free_member_index (db);
+				return;
+			}
+		}
+	}
+}
+
+static void index_del_entry (struct commonio_db *db,
+                             const struct commonio_entry *p)
+{
+	char *const *list;
+	unsigned int l;
+
+	if ((NULL == db->member_index) || (NULL == p->eptr)) {
+		return;
+	}
+
+	for (l = 0; (list = db->ops->members (p->eptr, l)) != NULL; l++) {
+		for (; NULL != *list; list++) {
+			struct member_postings *mp;
+			size_t i;
+
+			mp = find_postings (db->member_index, *list);
+			if (NULL == mp) {
+				continue;
+			}
+			/* Keep the other entries in order */
+			for (i = 0; i < mp->n; i++) {
+				if (mp->entries[i] == p) {
+					memmove (&mp->entries[i],
+					         &mp->entries[i + 1],
+					         (mp->n - i - 1) * sizeof *mp->entries);
+					mp->n--;
+					break;
+				}
+			}
+		}
+	}
+}
+
+/*
+ * commonio_index_members - build the reverse index of members
+ *
+ * The database must be open, and support the members operation.
+ *
+ * It returns 0 on error (errno set), 1 on success.
+ */
+int commonio_index_members (struct commonio_db *db)
+{
+	struct commonio_entry *p;
+
+	if (!db->isopen || (NULL == db->ops->members)) {
+		errno = EINVAL;
+		return 0;
+	}
+	if (NULL != db->member_index) {
+		return 1;
+	}
+
+	db->member_index = (struct commonio_member_index *)
+	                   calloc (1, sizeof *db->member_index);
+	if (NULL == db->member_index) {
+		errno = ENOMEM;
+		return 0;
+	}
+	db->member_index->nbuckets = 1024;
+	db->member_index->buckets = (struct member_postings **)
+	                            calloc (db->member_index->nbuckets,
+	                                    sizeof (struct member_postings *));
+	if (NULL == db->member_index->buckets) {
+		free (db->member_index);
+		db->member_index = NULL;
+		errno = ENOMEM;
+		return 0;
+	}
+
+	for (p = db->head; NULL != p; p = p->next) {
+		index_add_entry (db, p);
+		if (NULL == db->member_index) {
+			errno = ENOMEM;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*
+ * commonio_member_of - Return the entries listing a member
+ *
+ * It returns a newly allocated NULL terminated array of the entries
+ * which list member in one of their lists of members, or NULL on error
+ * (errno set).
+ * The array remains valid when the returned entries are updated, but
+ * each entry must only be used until it is itself updated or removed.
+ *
+ * Without a reverse index, the whole database is scanned.
+ */
+/*@null@*/ /*@only@*/const void **commonio_member_of (struct commonio_db *db,
+                                                  const char *member)
+{
+	const void **entries;
+	struct commonio_entry *p;
+	size_t n = 0;
+
+	if (!db->isopen || (NULL == db->ops->members)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (NULL != db->member_index) {
+		struct member_postings *mp;
+
+		mp = find_postings (db->member_index, member);
+		entries = (const void **) malloc (
+		              (((NULL != mp) ? mp->n : 0) + 1) * sizeof *entries);
+		if (NULL == entries) {
+			errno = ENOMEM;
+			return NULL;
+		}
+		for (; (NULL != mp) && (n < mp->n); n++) {
+			entries[n] = mp->entries[n]->eptr;
+		}
+		entries[n] = NULL;
+		return entries;
+	}
+
+	entries = (const void **) malloc (sizeof *entries);
+	if (NULL == entries) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	for (p = db->head; NULL != p; p = p->next) {
+		char *const *list;
+		unsigned int l;
+
+		if (NULL == p->eptr) {
+			continue;
+		}
+		for (l = 0; (list = db->ops->members (p->eptr, l)) != NULL; l++) {
+			while (   (NULL != *list)
+			       && (strcmp (*list, member) != 0)) {
+				list++;
+			}
+			if (NULL != *list) {
+				break;
+			}
+		}
+		if (NULL != list) {
+			const void **tmp;
+
+			tmp = (const void **) realloc (entries,
+			                               (n + 2) * sizeof *entries);
+			if (NULL == tmp) {
+				free (entries);
+				errno = ENOMEM;
+				return NULL;
+			}
+			entries = tmp;
+			entries[n] = p->eptr;
+			n++;
+		}
+	}
+	entries[n] = NULL;
+
+	return entries;
+}
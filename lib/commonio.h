@@ -95,8 +95,18 @@ struct commonio_ops {
 	 */
 	/*@null@*/int (*open_hook) (void);
 	/*@null@*/int (*close_hook) (void);
+
+	/*
+	 * Return the n-th NULL terminated list of member names of the
+	 * object (for example, gr_mem for struct group), or NULL if the
+	 * object has no more lists.
+	 * If NULL, the database cannot be indexed by member.
+	 */
+	/*@null@*/char *const *(*members) (const void *, unsigned int);
 };
 
+struct commonio_member_index;
+
 /*
  * Database structure.
  */
@@ -140,6 +150,12 @@ struct commonio_db {
 	bool locked:1;
 	bool readonly:1;
 	bool setname:1;
+
+	/*
+	 * Reverse index from member names to entries, if requested
+	 * with commonio_index_members().
+	 */
+	/*@owned@*/ /*@null@*/struct commonio_member_index *member_index;
 };
 
 extern int commonio_setname (struct commonio_db *, const char *);
@@ -163,5 +179,9 @@ extern int commonio_sort_wrt (struct commonio_db *shadow,
                               const struct commonio_db *passwd);
 extern int commonio_sort (struct commonio_db *db,
                           int (*cmp) (const void *, const void *));
+extern size_t commonio_hash (const char *name);
+extern int commonio_index_members (struct commonio_db *db);
+extern /*@null@*/ /*@only@*/const void **commonio_member_of (struct commonio_db *db,
+                                                          const char *member);
 
 #endif
@@ -326,6 +326,11 @@ char *strchr (), *strrchr (), *strtok ();
 #endif
 #endif
 
+/* Directory of the compiled forms of the configuration files */
+#ifndef CACHE_DIR
+#define CACHE_DIR "/var/cache/shadow"
+#endif
+
 #ifndef NULL
 #define NULL ((void *) 0)
 #endif
@@ -44,8 +44,11 @@
 {
 	static char cipher[128];
 	char *cp;
+	struct instr_mark mark;
 
+	instr_begin (&mark, "pw_encrypt");
 	cp = crypt (clear, salt);
+	instr_end (&mark);
 	if (NULL == cp) {
 		/*
 		 * Single Unix Spec: crypt() may return a null pointer,
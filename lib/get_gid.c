@@ -38,6 +38,13 @@ int get_gid (const char *gidstr, gid_t *gid)
 {
 	long long int val;
 	char *endptr;
+	unsigned long long dec;
+
+	if (   (getdec (gidstr, false, &dec) == 1)
+	    && (/*@+longintegral@*/dec == (gid_t)dec)/*@=longintegral@*/) {
+		*gid = (gid_t)dec;
+		return 1;
+	}
 
 	errno = 0;
 	val = strtoll (gidstr, &endptr, 10);
@@ -38,6 +38,13 @@ int get_uid (const char *uidstr, uid_t *uid)
 {
 	long long int val;
 	char *endptr;
+	unsigned long long dec;
+
+	if (   (getdec (uidstr, false, &dec) == 1)
+	    && (/*@+longintegral@*/dec == (uid_t)dec)/*@=longintegral@*/) {
+		*uid = (uid_t)dec;
+		return 1;
+	}
 
 	errno = 0;
 	val = strtoll (uidstr, &endptr, 10);
@@ -40,7 +40,10 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #ifdef USE_ECONF
+#include <dirent.h>
 #include <libeconf.h>
 #endif
 #include "getdef.h"
@@ -50,123 +53,131 @@
 struct itemdef {
 	/*@null@*/const char *name;	/* name of the item                     */
 	/*@null@*/char *value;		/* value given, or NULL if no value     */
+	bool value_mapped;		/* value is in the mapped snapshot      */
+	/* numeric values, parsed once when the value is set */
+	bool long_ok;			/* value is a valid long                */
+	bool ulong_ok;			/* value is a valid unsigned long       */
+	long long_value;
+	unsigned long ulong_value;
 };
 
 #define PAMDEFS					\
-	{"CHFN_AUTH", NULL},			\
-	{"CHSH_AUTH", NULL},			\
-	{"CRACKLIB_DICTPATH", NULL},		\
-	{"ENV_HZ", NULL},			\
-	{"ENVIRON_FILE", NULL},			\
-	{"ENV_TZ", NULL},			\
-	{"FAILLOG_ENAB", NULL},			\
-	{"FTMP_FILE", NULL},			\
-	{"HMAC_CRYPTO_ALGO", NULL},		\
-	{"ISSUE_FILE", NULL},			\
-	{"LASTLOG_ENAB", NULL},			\
-	{"LOGIN_STRING", NULL},			\
-	{"MAIL_CHECK_ENAB", NULL},		\
-	{"MOTD_FILE", NULL},			\
-	{"NOLOGINS_FILE", NULL},		\
-	{"OBSCURE_CHECKS_ENAB", NULL},		\
-	{"PASS_ALWAYS_WARN", NULL},		\
-	{"PASS_CHANGE_TRIES", NULL},		\
-	{"PASS_MAX_LEN", NULL},			\
-	{"PASS_MIN_LEN", NULL},			\
-	{"PORTTIME_CHECKS_ENAB", NULL},		\
-	{"QUOTAS_ENAB", NULL},			\
-	{"SU_WHEEL_ONLY", NULL},		\
-	{"ULIMIT", NULL},
+	{.name = "CHFN_AUTH"},		\
+	{.name = "CHSH_AUTH"},		\
+	{.name = "CRACKLIB_DICTPATH"},	\
+	{.name = "ENV_HZ"},		\
+	{.name = "ENVIRON_FILE"},	\
+	{.name = "ENV_TZ"},		\
+	{.name = "FAILLOG_ENAB"},	\
+	{.name = "FTMP_FILE"},		\
+	{.name = "HMAC_CRYPTO_ALGO"},	\
+	{.name = "ISSUE_FILE"},		\
+	{.name = "LASTLOG_ENAB"},	\
+	{.name = "LOGIN_STRING"},	\
+	{.name = "MAIL_CHECK_ENAB"},	\
+	{.name = "MOTD_FILE"},		\
+	{.name = "NOLOGINS_FILE"},	\
+	{.name = "OBSCURE_CHECKS_ENAB"}, \
+	{.name = "PASS_ALWAYS_WARN"},	\
+	{.name = "PASS_CHANGE_TRIES"},	\
+	{.name = "PASS_MAX_LEN"},	\
+	{.name = "PASS_MIN_LEN"},	\
+	{.name = "PORTTIME_CHECKS_ENAB"}, \
+	{.name = "QUOTAS_ENAB"},	\
+	{.name = "SU_WHEEL_ONLY"},	\
+	{.name = "ULIMIT"},
 
 /*
  * Items used in other tools (util-linux, etc.)
  */
 #define FOREIGNDEFS				\
-	{"ALWAYS_SET_PATH", NULL},		\
-	{"ENV_ROOTPATH", NULL},			\
-	{"LOGIN_KEEP_USERNAME", NULL},		\
-	{"LOGIN_PLAIN_PROMPT", NULL},		\
-	{"MOTD_FIRSTONLY", NULL},		\
+	{.name = "ALWAYS_SET_PATH"},	\
+	{.name = "ENV_ROOTPATH"},	\
+	{.name = "LOGIN_KEEP_USERNAME"}, \
+	{.name = "LOGIN_PLAIN_PROMPT"},	\
+	{.name = "MOTD_FIRSTONLY"},	\
 
 
 #define NUMDEFS	(sizeof(def_table)/sizeof(def_table[0]))
 static struct itemdef def_table[] = {
-	{"CHFN_RESTRICT", NULL},
-	{"CONSOLE_GROUPS", NULL},
-	{"CONSOLE", NULL},
-	{"CREATE_HOME", NULL},
-	{"DEFAULT_HOME", NULL},
-	{"ENCRYPT_METHOD", NULL},
-	{"ENV_PATH", NULL},
-	{"ENV_SUPATH", NULL},
-	{"ERASECHAR", NULL},
-	{"FAIL_DELAY", NULL},
-	{"FAKE_SHELL", NULL},
-	{"GID_MAX", NULL},
-	{"GID_MIN", NULL},
-	{"HOME_MODE", NULL},
-	{"HUSHLOGIN_FILE", NULL},
-	{"KILLCHAR", NULL},
-	{"LASTLOG_UID_MAX", NULL},
-	{"LOGIN_RETRIES", NULL},
-	{"LOGIN_TIMEOUT", NULL},
-	{"LOG_OK_LOGINS", NULL},
-	{"LOG_UNKFAIL_ENAB", NULL},
-	{"MAIL_DIR", NULL},
-	{"MAIL_FILE", NULL},
-	{"MAX_MEMBERS_PER_GROUP", NULL},
-	{"MD5_CRYPT_ENAB", NULL},
-	{"NONEXISTENT", NULL},
-	{"PASS_MAX_DAYS", NULL},
-	{"PASS_MIN_DAYS", NULL},
-	{"PASS_WARN_AGE", NULL},
+	{.name = "CACHE_FLUSH_DELAY"},
+	{.name = "CHFN_RESTRICT"},
+	{.name = "CONSOLE_GROUPS"},
+	{.name = "CONSOLE"},
+	{.name = "CREATE_HOME"},
+	{.name = "DEFAULT_HOME"},
+	{.name = "ENCRYPT_METHOD"},
+	{.name = "ENV_PATH"},
+	{.name = "ENV_SUPATH"},
+	{.name = "ERASECHAR"},
+	{.name = "FAIL_DELAY"},
+	{.name = "FAKE_SHELL"},
+	{.name = "GID_MAX"},
+	{.name = "GID_MIN"},
+	{.name = "HOME_MODE"},
+	{.name = "HUSHLOGIN_FILE"},
+	{.name = "KILLCHAR"},
+	{.name = "LASTLOG_UID_MAX"},
+	{.name = "LOGIN_RETRIES"},
+	{.name = "LOGIN_TIMEOUT"},
+	{.name = "LOG_OK_LOGINS"},
+	{.name = "LOG_UNKFAIL_ENAB"},
+	{.name = "MAIL_DIR"},
+	{.name = "MAIL_FILE"},
+	{.name = "MAX_MEMBERS_PER_GROUP"},
+	{.name = "MD5_CRYPT_ENAB"},
+	{.name = "NONEXISTENT"},
+	{.name = "PASS_MAX_DAYS"},
+	{.name = "PASS_MIN_DAYS"},
+	{.name = "PASS_WARN_AGE"},
+	{.name = "RUN_PARTS_JOBS"},
 #ifdef USE_SHA_CRYPT
-	{"SHA_CRYPT_MAX_ROUNDS", NULL},
-	{"SHA_CRYPT_MIN_ROUNDS", NULL},
+	{.name = "SHA_CRYPT_MAX_ROUNDS"},
+	{.name = "SHA_CRYPT_MIN_ROUNDS"},
 #endif
 #ifdef USE_BCRYPT
-	{"BCRYPT_MAX_ROUNDS", NULL},
-	{"BCRYPT_MIN_ROUNDS", NULL},
+	{.name = "BCRYPT_MAX_ROUNDS"},
+	{.name = "BCRYPT_MIN_ROUNDS"},
 #endif
 #ifdef USE_YESCRYPT
-	{"YESCRYPT_COST_FACTOR", NULL},
+	{.name = "YESCRYPT_COST_FACTOR"},
 #endif
-	{"SUB_GID_COUNT", NULL},
-	{"SUB_GID_MAX", NULL},
-	{"SUB_GID_MIN", NULL},
-	{"SUB_UID_COUNT", NULL},
-	{"SUB_UID_MAX", NULL},
-	{"SUB_UID_MIN", NULL},
-	{"SULOG_FILE", NULL},
-	{"SU_NAME", NULL},
-	{"SYS_GID_MAX", NULL},
-	{"SYS_GID_MIN", NULL},
-	{"SYS_UID_MAX", NULL},
-	{"SYS_UID_MIN", NULL},
-	{"TTYGROUP", NULL},
-	{"TTYPERM", NULL},
-	{"TTYTYPE_FILE", NULL},
-	{"UID_MAX", NULL},
-	{"UID_MIN", NULL},
-	{"UMASK", NULL},
-	{"USERDEL_CMD", NULL},
-	{"USERGROUPS_ENAB", NULL},
+	{.name = "SUB_GID_COUNT"},
+	{.name = "SUB_GID_MAX"},
+	{.name = "SUB_GID_MIN"},
+	{.name = "SUB_UID_COUNT"},
+	{.name = "SUB_UID_MAX"},
+	{.name = "SUB_UID_MIN"},
+	{.name = "SULOG_FILE"},
+	{.name = "SU_NAME"},
+	{.name = "SYS_GID_MAX"},
+	{.name = "SYS_GID_MIN"},
+	{.name = "SYS_UID_MAX"},
+	{.name = "SYS_UID_MIN"},
+	{.name = "TTYGROUP"},
+	{.name = "TTYPERM"},
+	{.name = "TTYTYPE_FILE"},
+	{.name = "UID_MAX"},
+	{.name = "UID_MIN"},
+	{.name = "UMASK"},
+	{.name = "USERDEL_CMD"},
+	{.name = "USERGROUPS_ENAB"},
 #ifndef USE_PAM
 	PAMDEFS
 #endif
 #ifdef USE_SYSLOG
-	{"SYSLOG_SG_ENAB", NULL},
-	{"SYSLOG_SU_ENAB", NULL},
+	{.name = "SYSLOG_SG_ENAB"},
+	{.name = "SYSLOG_SU_ENAB"},
 #endif
 #ifdef WITH_TCB
-	{"TCB_AUTH_GROUP", NULL},
-	{"TCB_SYMLINKS", NULL},
-	{"USE_TCB", NULL},
+	{.name = "TCB_AUTH_GROUP"},
+	{.name = "TCB_SYMLINKS"},
+	{.name = "USE_TCB"},
 #endif
-	{"FORCE_SHADOW", NULL},
-	{"GRANT_AUX_GROUP_SUBIDS", NULL},
-	{"PREVENT_NO_AUTH", NULL},
-	{NULL, NULL}
+	{.name = "FORCE_SHADOW"},
+	{.name = "GRANT_AUX_GROUP_SUBIDS"},
+	{.name = "PREVENT_NO_AUTH"},
+	{.name = NULL}
 };
 
 #define NUMKNOWNDEFS	(sizeof(knowndef_table)/sizeof(knowndef_table[0]))
@@ -175,7 +186,7 @@ static struct itemdef knowndef_table[] = {
 	PAMDEFS
 #endif
 	FOREIGNDEFS
-	{NULL, NULL}
+	{.name = NULL}
 };
 
 #ifdef USE_ECONF
@@ -192,8 +203,38 @@ static const char* sysconfdir = "/etc";
 
 static const char* def_fname = LOGINDEFS;	/* login config defs file       */
 #endif
+
+/*
+ * Snapshot of the login definitions in CACHE_DIR: the name and value of
+ * each item, as NUL terminated strings, each followed by the parsed
+ * value: a flags byte (DEFS_LONG_OK, DEFS_ULONG_OK), and the value as an
+ * int64_t and as an uint64_t.
+ * With econf, the configuration is read from several files, so the
+ * snapshot starts with the path and the key (see cache_buf_add_key()) of
+ * each of them, and of the drop-in directories and their entries.
+ * The values are used in place: the snapshot stays mapped.
+ */
+#define DEFS_CACHE	"login.defs"
+#ifdef USE_ECONF
+#define DEFS_MAGIC	"defs2e"
+#else
+#define DEFS_MAGIC	"defs2"
+#endif
+#define DEFS_LONG_OK	0x01
+#define DEFS_ULONG_OK	0x02
+#define DEFS_NUM_SIZE	(1 + sizeof (int64_t) + sizeof (uint64_t))
 static bool def_loaded = false;		/* are defs already loaded?     */
 
+/*
+ * Hash index of def_table and knowndef_table, built on the first lookup.
+ * It is sized so that it is at most half full.
+ */
+#define DEF_INDEX_SIZE	256
+static /*@null@*/struct itemdef *def_index[DEF_INDEX_SIZE];
+/* Fails to compile if the tables outgrow the index */
+typedef char def_index_check[(NUMDEFS + NUMKNOWNDEFS <= DEF_INDEX_SIZE / 2) ? 1 : -1];
+static bool def_indexed = false;
+
 /* local function prototypes */
 static /*@observer@*/ /*@null@*/struct itemdef *def_find (const char *);
 static void def_load (void);
@@ -264,7 +305,8 @@ int getdef_num (const char *item, int dflt)
 		return dflt;
 	}
 
-	if (   (getlong (d->value, &val) == 0)
+	val = d->long_value;
+	if (   !d->long_ok
 	    || (val > INT_MAX)
 	    || (val < INT_MIN)) {
 		fprintf (shadow_logfd,
@@ -299,7 +341,8 @@ unsigned int getdef_unum (const char *item, unsigned int dflt)
 		return dflt;
 	}
 
-	if (   (getlong (d->value, &val) == 0)
+	val = d->long_value;
+	if (   !d->long_ok
 	    || (val < 0)
 	    || (val > INT_MAX)) {
 		fprintf (shadow_logfd,
@@ -323,7 +366,6 @@ unsigned int getdef_unum (const char *item, unsigned int dflt)
 long getdef_long (const char *item, long dflt)
 {
 	struct itemdef *d;
-	long val;
 
 	if (!def_loaded) {
 		def_load ();
@@ -334,14 +376,14 @@ long getdef_long (const char *item, long dflt)
 		return dflt;
 	}
 
-	if (getlong (d->value, &val) == 0) {
+	if (!d->long_ok) {
 		fprintf (shadow_logfd,
 		         _("configuration error - cannot parse %s value: '%s'"),
 		         item, d->value);
 		return dflt;
 	}
 
-	return val;
+	return d->long_value;
 }
 
 /*
@@ -355,7 +397,6 @@ long getdef_long (const char *item, long dflt)
 unsigned long getdef_ulong (const char *item, unsigned long dflt)
 {
 	struct itemdef *d;
-	unsigned long val;
 
 	if (!def_loaded) {
 		def_load ();
@@ -366,15 +407,14 @@ unsigned long getdef_ulong (const char *item, unsigned long dflt)
 		return dflt;
 	}
 
-	if (getulong (d->value, &val) == 0) {
-		/* FIXME: we should have a getulong */
+	if (!d->ulong_ok) {
 		fprintf (shadow_logfd,
 		         _("configuration error - cannot parse %s value: '%s'"),
 		         item, d->value);
 		return dflt;
 	}
 
-	return val;
+	return d->ulong_value;
 }
 
 /*
@@ -411,15 +451,36 @@ int putdef_str (const char *name, const char *value)
 		return -1;
 	}
 
-	if (NULL != d->value) {
+	if ((NULL != d->value) && !d->value_mapped) {
 		free (d->value);
 	}
 
 	d->value = cp;
+	d->value_mapped = false;
+	d->long_ok = (getlong (cp, &d->long_value) != 0);
+	d->ulong_ok = (getulong (cp, &d->ulong_value) != 0);
 	return 0;
 }
 
 
+/*
+ * def_index_add - add the items of table to the hash index
+ */
+
+static void def_index_add (struct itemdef *table)
+{
+	struct itemdef *ptr;
+
+	for (ptr = table; NULL != ptr->name; ptr++) {
+		size_t h = commonio_hash (ptr->name);
+
+		while (NULL != def_index[h % DEF_INDEX_SIZE]) {
+			h++;
+		}
+		def_index[h % DEF_INDEX_SIZE] = ptr;
+	}
+}
+
 /*
  * def_find - locate named item in table
  *
@@ -430,33 +491,46 @@ int putdef_str (const char *name, const char *value)
 static /*@observer@*/ /*@null@*/struct itemdef *def_find (const char *name)
 {
 	struct itemdef *ptr;
+	size_t h;
+
+	if (!def_indexed) {
+		def_index_add (def_table);
+		def_index_add (knowndef_table);
+		def_indexed = true;
+	}
 
 	/*
-	 * Search into the table.
+	 * Search into the index.
 	 */
 
-	for (ptr = def_table; NULL != ptr->name; ptr++) {
+	for (h = commonio_hash (name);
+	     NULL != (ptr = def_index[h % DEF_INDEX_SIZE]);
+	     h++) {
 		if (strcmp (ptr->name, name) == 0) {
-			return ptr;
+			break;
 		}
 	}
 
+	if (NULL == ptr) {
+		/*
+		 * Item was never found.
+		 */
+		fprintf (shadow_logfd,
+		         _("configuration error - unknown item '%s' (notify administrator)\n"),
+		         name);
+		SYSLOG ((LOG_CRIT, "unknown configuration item `%s'", name));
+		return (struct itemdef *) NULL;
+	}
+
 	/*
-	 * Item was never found.
+	 * Items of knowndef_table are known, but not used by shadow.
 	 */
-
-	for (ptr = knowndef_table; NULL != ptr->name; ptr++) {
-		if (strcmp (ptr->name, name) == 0) {
-			goto out;
-		}
+	if (   (ptr >= knowndef_table)
+	    && (ptr < knowndef_table + NUMKNOWNDEFS)) {
+		return (struct itemdef *) NULL;
 	}
-	fprintf (shadow_logfd,
-	         _("configuration error - unknown item '%s' (notify administrator)\n"),
-	         name);
-	SYSLOG ((LOG_CRIT, "unknown configuration item `%s'", name));
 
-out:
-	return (struct itemdef *) NULL;
+	return ptr;
 }
 
 /*
@@ -490,6 +564,200 @@ void setdef_config_file (const char* file)
 #endif
 }
 
+/*
+ * def_load_snapshot - load the items from a snapshot
+ *
+ * The values point into the snapshot, which shall stay mapped.
+ *
+ * Return 0 on success, -1 if the snapshot is invalid.
+ */
+
+static int def_load_snapshot (const char *data, size_t len)
+{
+	const char *end = data + len;
+	const char *cp;
+
+	/* Validate the whole snapshot before storing any value */
+	for (cp = data; cp < end; cp += DEFS_NUM_SIZE) {
+		const char *value = memchr (cp, '\0', (size_t) (end - cp));
+
+		if (NULL == value) {
+			return -1;
+		}
+		value++;
+		cp = memchr (value, '\0', (size_t) (end - value));
+		if (   (NULL == cp)
+		    || ((size_t) (end - cp - 1) < DEFS_NUM_SIZE)) {
+			return -1;
+		}
+		cp++;
+	}
+
+	for (cp = data; cp < end; ) {
+		const char *name = cp;
+		const char *value = name + strlen (name) + 1;
+		struct itemdef *d;
+		unsigned char flags;
+		int64_t lval;
+		uint64_t ulval;
+
+		cp = value + strlen (value) + 1;
+		flags = (unsigned char) *cp;
+		memcpy (&lval, cp + 1, sizeof lval);
+		memcpy (&ulval, cp + 1 + sizeof lval, sizeof ulval);
+		cp += DEFS_NUM_SIZE;
+
+		/*
+		 * Unknown items are reported by def_find(), like
+		 * putdef_str() does.
+		 */
+		d = def_find (name);
+		if (NULL == d) {
+			continue;
+		}
+		if ((NULL != d->value) && !d->value_mapped) {
+			free (d->value);
+		}
+		d->value = (char *) value;
+		d->value_mapped = true;
+		/* The snapshot may be shared with a program with a smaller long */
+		d->long_ok = (   ((flags & DEFS_LONG_OK) != 0)
+		              && (lval >= LONG_MIN) && (lval <= LONG_MAX));
+		d->long_value = d->long_ok ? (long) lval : 0;
+		d->ulong_ok = (   ((flags & DEFS_ULONG_OK) != 0)
+		               && (ulval <= ULONG_MAX));
+		d->ulong_value = d->ulong_ok ? (unsigned long) ulval : 0;
+	}
+	return 0;
+}
+
+/*
+ * def_snapshot_add - add an item to the snapshot being built
+ *
+ * On failure, the snapshot is dropped.
+ */
+
+static void def_snapshot_add (char **snap, size_t *len, size_t *size,
+                              const char *name, const char *value)
+{
+	unsigned char flags = 0;
+	long lval = 0;
+	unsigned long ulval = 0;
+	int64_t lval64;
+	uint64_t ulval64;
+	size_t need;
+
+	if (NULL == *snap) {
+		return;
+	}
+	need = strlen (name) + strlen (value) + 2 + DEFS_NUM_SIZE;
+	if (*len + need > *size) {
+		char *tmp;
+
+		*size = (*size + need) * 2;
+		tmp = realloc (*snap, *size);
+		if (NULL == tmp) {
+			free (*snap);
+			*snap = NULL;
+			return;
+		}
+		*snap = tmp;
+	}
+	if (getlong (value, &lval) != 0) {
+		flags |= DEFS_LONG_OK;
+	}
+	if (getulong (value, &ulval) != 0) {
+		flags |= DEFS_ULONG_OK;
+	}
+	lval64 = (int64_t) lval;
+	ulval64 = (uint64_t) ulval;
+
+	strcpy (*snap + *len, name);
+	*len += strlen (name) + 1;
+	strcpy (*snap + *len, value);
+	*len += strlen (value) + 1;
+	(*snap)[*len] = (char) flags;
+	memcpy (*snap + *len + 1, &lval64, sizeof lval64);
+	memcpy (*snap + *len + 1 + sizeof lval64, &ulval64, sizeof ulval64);
+	*len += DEFS_NUM_SIZE;
+}
+
+#ifdef USE_ECONF
+/*
+ * def_econf_key_add - add a source of the configuration to a snapshot key
+ *
+ * The source is dir/name. With dropins, it is a drop-in directory, and
+ * its entries are added as well, so that a drop-in file edited in place
+ * is noticed.
+ *
+ * Return 0 on success, -1 on failure.
+ */
+
+static int def_econf_key_add (struct cache_buf *key, const char *dir,
+                              const char *name, bool dropins)
+{
+	char path[1024];
+	struct stat sb;
+	struct dirent **entries;
+	int n, i;
+	int ret = 0;
+
+	if (snprintf (path, sizeof path, "%s/%s", dir, name) >= (int) sizeof path) {
+		return -1;
+	}
+	if (   (cache_buf_add (key, path, strlen (path) + 1) != 0)
+	    || (cache_buf_add_key (key, (stat (path, &sb) == 0) ? &sb : NULL) != 0)) {
+		return -1;
+	}
+	if (!dropins) {
+		return 0;
+	}
+
+	n = scandir (path, &entries, NULL, alphasort);
+	if (n < 0) {
+		/* A missing directory already has its own key */
+		return ((ENOENT == errno) || (ENOTDIR == errno)) ? 0 : -1;
+	}
+	for (i = 0; i < n; i++) {
+		char entry[1024];
+		const char *ename = entries[i]->d_name;
+
+		if (   (0 == ret)
+		    && (strcmp (ename, ".") != 0)
+		    && (strcmp (ename, "..") != 0)) {
+			if (   (snprintf (entry, sizeof entry, "%s/%s", path, ename) >= (int) sizeof entry)
+			    || (cache_buf_add (key, ename, strlen (ename) + 1) != 0)
+			    || (cache_buf_add_key (key, (stat (entry, &sb) == 0) ? &sb : NULL) != 0)) {
+				ret = -1;
+			}
+		}
+		free (entries[i]);
+	}
+	free (entries);
+	return ret;
+}
+
+/*
+ * def_econf_key - build the key of the snapshot of the configuration
+ *
+ * Return 0 on success, -1 on failure.
+ */
+
+static int def_econf_key (struct cache_buf *key)
+{
+	if (   (NULL != vendordir)
+	    && (   (def_econf_key_add (key, vendordir, "login.defs", false) != 0)
+	        || (def_econf_key_add (key, vendordir, "login.defs.d", true) != 0))) {
+		return -1;
+	}
+	if (   (def_econf_key_add (key, sysconfdir, "login.defs", false) != 0)
+	    || (def_econf_key_add (key, sysconfdir, "login.defs.d", true) != 0)) {
+		return -1;
+	}
+	return 0;
+}
+#endif
+
 /*
  * def_load - load configuration table
  *
@@ -503,11 +771,18 @@ static void def_load (void)
 	econf_err error;
 	char **keys;
 	size_t key_number;
+	struct cache_buf key = { NULL, 0, 0 };
+	struct stat sb;
 #else
 	int i;
 	FILE *fp;
 	char buf[1024], *name, *value, *s;
+	struct stat sb;
+	bool use_snapshot;
 #endif
+	char *snap = NULL;
+	size_t snap_len = 0;
+	size_t snap_size = 1024;
 
 	/*
 	 * Set the initialized flag.
@@ -516,9 +791,42 @@ static void def_load (void)
 	def_loaded = true;
 
 #ifdef USE_ECONF
+	/*
+	 * Use the snapshot of the default configuration if none of its
+	 * files changed. Otherwise, read the configuration and refresh
+	 * the snapshot.
+	 * The files are checked by the key at the start of the snapshot:
+	 * the cache header is only given an empty stat.
+	 */
+	memzero (&sb, sizeof sb);
+	if (   (strcmp (sysconfdir, "/etc") == 0)
+	    && (def_econf_key (&key) == 0)) {
+		const char *data;
+		size_t len;
+
+		data = cache_map (DEFS_CACHE, DEFS_MAGIC, &sb, &len);
+		if (NULL != data) {
+			if (   (len >= key.len)
+			    && (memcmp (data, key.data, key.len) == 0)
+			    && (def_load_snapshot (data + key.len, len - key.len) == 0)) {
+				/* The values are in the snapshot */
+				free (key.data);
+				return;
+			}
+			cache_unmap (data, len);
+		}
+		snap_size += key.len;
+		snap = malloc (snap_size);
+		if (NULL != snap) {
+			memcpy (snap, key.data, key.len);
+			snap_len = key.len;
+		}
+	}
+	free (key.data);
 
 	error = econf_readDirs (&defs_file, vendordir, sysconfdir, "login", "defs", " \t", "#");
 	if (error) {
+		free (snap);
 		if (error == ECONF_NOFILE)
 			return;
 
@@ -534,7 +842,7 @@ static void def_load (void)
 	}
 
 	for (size_t i = 0; i < key_number; i++) {
-		char *value;
+		char *value = NULL;
 
 		econf_getStringValue(defs_file, NULL, keys[i], &value);
 
@@ -546,10 +854,18 @@ static void def_load (void)
 		 * syslog. The tools will just use their default values.
 		 */
 		(void)putdef_str (keys[i], value);
+		if (NULL != value) {
+			def_snapshot_add (&snap, &snap_len, &snap_size, keys[i], value);
+		}
 	}
 
 	econf_free (keys);
 	econf_free (defs_file);
+
+	if (NULL != snap) {
+		(void) cache_write (DEFS_CACHE, DEFS_MAGIC, &sb, snap, snap_len);
+		free (snap);
+	}
 #else
 	/*
 	 * Open the configuration definitions file.
@@ -565,6 +881,29 @@ static void def_load (void)
 		exit (EXIT_FAILURE);
 	}
 
+	/*
+	 * Use the snapshot of the default configuration file if it is
+	 * still up to date. Otherwise, parse the file and refresh the
+	 * snapshot.
+	 */
+	use_snapshot = (   (strcmp (def_fname, LOGINDEFS) == 0)
+	                && (fstat (fileno (fp), &sb) == 0));
+	if (use_snapshot) {
+		const void *data;
+		size_t len;
+
+		data = cache_map (DEFS_CACHE, DEFS_MAGIC, &sb, &len);
+		if (NULL != data) {
+			if (def_load_snapshot (data, len) == 0) {
+				/* The values are in the snapshot */
+				(void) fclose (fp);
+				return;
+			}
+			cache_unmap (data, len);
+		}
+		snap = malloc (snap_size);
+	}
+
 	/*
 	 * Go through all of the lines in the file.
 	 */
@@ -604,6 +943,7 @@ static void def_load (void)
 		 * syslog. The tools will just use their default values.
 		 */
 		(void)putdef_str (name, value);
+		def_snapshot_add (&snap, &snap_len, &snap_size, name, value);
 	}
 
 	if (ferror (fp) != 0) {
@@ -614,6 +954,11 @@ static void def_load (void)
 	}
 
 	(void) fclose (fp);
+
+	if (NULL != snap) {
+		(void) cache_write (DEFS_CACHE, DEFS_MAGIC, &sb, snap, snap_len);
+		free (snap);
+	}
 #endif
 }
 
@@ -33,8 +33,38 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
 #include "prototypes.h"
 
+/*
+ * getdec - fast path of the number parsers, for plain decimal numbers
+ *
+ * It only accepts 1 to 18 decimal digits, which cannot overflow, without
+ * blanks or sign. If base0 is set, a leading 0 is rejected, since strtol
+ * would read an octal number.
+ *
+ * Returns 0 if numstr is not such a number: the callers then use the
+ * strto* functions.
+ */
+int getdec (const char *numstr, bool base0, /*@out@*/unsigned long long *result)
+{
+	unsigned long long val = 0;
+	const char *cp;
+
+	if (base0 && ('0' == numstr[0]) && ('\0' != numstr[1])) {
+		return 0;
+	}
+	for (cp = numstr; (*cp >= '0') && (*cp <= '9'); cp++) {
+		val = val * 10 + (unsigned long long) (*cp - '0');
+	}
+	if ((cp == numstr) || ('\0' != *cp) || ((cp - numstr) > 18)) {
+		return 0;
+	}
+
+	*result = val;
+	return 1;
+}
+
 /*
  * getlong - extract a long integer provided by the numstr string in *result
  *
@@ -46,6 +76,12 @@ int getlong (const char *numstr, /*@out@*/long int *result)
 {
 	long val;
 	char *endptr;
+	unsigned long long dec;
+
+	if ((getdec (numstr, true, &dec) == 1) && (dec <= LONG_MAX)) {
+		*result = (long) dec;
+		return 1;
+	}
 
 	errno = 0;
 	val = strtol (numstr, &endptr, 0);
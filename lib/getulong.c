@@ -33,6 +33,7 @@
 
 #include <stdlib.h>
 #include <errno.h>
+#include <limits.h>
 #include "prototypes.h"
 
 /*
@@ -46,6 +47,12 @@ int getulong (const char *numstr, /*@out@*/unsigned long int *result)
 {
 	unsigned long int val;
 	char *endptr;
+	unsigned long long dec;
+
+	if ((getdec (numstr, true, &dec) == 1) && (dec <= ULONG_MAX)) {
+		*result = (unsigned long int) dec;
+		return 1;
+	}
 
 	errno = 0;
 	val = strtoul (numstr, &endptr, 0);
@@ -100,6 +100,13 @@ static int group_put (const void *ent, FILE * file)
 	return (putgrent (gr, file) == -1) ? -1 : 0;
 }
 
+static /*@null@*/char *const *group_members (const void *ent, unsigned int n)
+{
+	const struct group *gr = ent;
+
+	return (0 == n) ? gr->gr_mem : NULL;
+}
+
 static int group_close_hook (void)
 {
 	unsigned int max_members = getdef_unum("MAX_MEMBERS_PER_GROUP", 0);
@@ -120,7 +127,8 @@ static struct commonio_ops group_ops = {
 	fgetsx,
 	fputsx,
 	group_open_hook,
-	group_close_hook
+	group_close_hook,
+	group_members
 };
 
 static /*@owned@*/struct commonio_db group_db = {
@@ -140,7 +148,8 @@ static /*@owned@*/struct commonio_db group_db = {
 	false,			/* isopen */
 	false,			/* locked */
 	false,			/* readonly */
-	false			/* setname */
+	false,			/* setname */
+	NULL			/* member_index */
 };
 
 int gr_setdbname (const char *filename)
@@ -185,6 +194,27 @@ int gr_update (const struct group *gr)
 	return commonio_update (&group_db, (const void *) gr);
 }
 
+/*
+ * gr_index_members - build a reverse index from members to groups.
+ *
+ * It speeds up gr_member_of() until the database is closed.
+ */
+int gr_index_members (void)
+{
+	return commonio_index_members (&group_db);
+}
+
+/*
+ * gr_member_of - return the groups listing a user as a member.
+ *
+ * The returned array is NULL terminated, and must be freed by the
+ * caller. The groups must not be used after they are updated.
+ */
+/*@null@*/ /*@only@*/const struct group **gr_member_of (const char *name)
+{
+	return (const struct group **) commonio_member_of (&group_db, name);
+}
+
 int gr_remove (const char *name)
 {
 	return commonio_remove (&group_db, name);
@@ -316,8 +346,7 @@ static /*@null@*/struct commonio_entry *merge_group_entries (
 {
 	struct group *gptr1;
 	struct group *gptr2;
-	char **new_members;
-	size_t members = 0;
+	struct memberset *members;
 	char *new_line;
 	size_t new_line_len, i;
 	if (NULL == gr2 || NULL == gr1) {
@@ -341,50 +370,30 @@ static /*@null@*/struct commonio_entry *merge_group_entries (
 	}
 	snprintf(new_line, new_line_len + 1, "%s\n%s", gr1->line, gr2->line);
 
-	/* Concatenate the 2 list of members */
-	for (i=0; NULL != gptr1->gr_mem[i]; i++);
-	members += i;
-	for (i=0; NULL != gptr2->gr_mem[i]; i++) {
-		char **pmember = gptr1->gr_mem;
-		while (NULL != *pmember) {
-			if (0 == strcmp(*pmember, gptr2->gr_mem[i])) {
-				break;
-			}
-			pmember++;
-		}
-		if (NULL == *pmember) {
-			members++;
-		}
-	}
-	new_members = (char **)calloc ( (members+1), sizeof(char*) );
-	if (NULL == new_members) {
+	/*
+	 * Concatenate the 2 list of members. Use a member set, so that
+	 * merging the pieces of a big split group stays linear.
+	 */
+	members = memberset_new (gptr1->gr_mem);
+	if (NULL == members) {
 		free (new_line);
-		errno = ENOMEM;
 		return NULL;
 	}
-	for (i=0; NULL != gptr1->gr_mem[i]; i++) {
-		new_members[i] = gptr1->gr_mem[i];
-	}
-	/* NULL termination enforced by above calloc */
-
-	members = i;
 	for (i=0; NULL != gptr2->gr_mem[i]; i++) {
-		char **pmember = new_members;
-		while (NULL != *pmember) {
-			if (0 == strcmp(*pmember, gptr2->gr_mem[i])) {
-				break;
-			}
-			pmember++;
-		}
-		if (NULL == *pmember) {
-			new_members[members] = gptr2->gr_mem[i];
-			members++;
-			new_members[members] = NULL;
+		if (memberset_add (members, gptr2->gr_mem[i]) == -1) {
+			memberset_free (members);
+			free (new_line);
+			return NULL;
 		}
 	}
+	if (!gr_set_members (gptr1, members)) {
+		memberset_free (members);
+		free (new_line);
+		return NULL;
+	}
+	memberset_free (members);
 
 	gr1->line = new_line;
-	gptr1->gr_mem = new_members;
 
 	return gr1;
 }
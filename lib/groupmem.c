@@ -139,3 +139,301 @@ bool gr_append_member(struct group *grp, char *member)
 	grp->gr_mem[i + 1] = NULL;
 	return true;
 }
+
+/*
+ * Member sets
+ *
+ * A member set holds the member names of a group (gr_mem) or of a
+ * shadow group (sg_mem, sg_adm) with constant time lookups, and
+ * amortized constant time insertions and removals.
+ *
+ * The names are kept in insertion order in an array. Removed names
+ * leave a hole in the array, which is squeezed out when the hash table
+ * is rebuilt. The set is only materialized back into a NULL terminated
+ * list with memberset_list() when the entry is handed to gr_update() or
+ * sgr_update(), to be written by group_put() or gshadow_put().
+ *
+ * The hash table stores indexes in this array (plus one, so that 0
+ * means an empty bucket).
+ */
+#define MEMBERSET_DELETED	((size_t) -1)
+
+struct memberset {
+	char **names;		/* names in insertion order, NULL for holes */
+	size_t used;		/* number of slots used in names */
+	size_t alloc;		/* number of slots allocated in names */
+	size_t count;		/* number of members */
+	size_t *buckets;
+	size_t nbuckets;	/* always a power of 2 */
+};
+
+/*
+ * Return the bucket of name, or the empty bucket where it shall be
+ * inserted.
+ */
+static size_t *memberset_bucket (const struct memberset *set,
+                                 const char *name)
+{
+	size_t mask = set->nbuckets - 1;
+	size_t i = commonio_hash (name) & mask;
+	size_t *free_bucket = NULL;
+
+	for (;;) {
+		size_t *b = &set->buckets[i];
+
+		if (0 == *b) {
+			return (NULL != free_bucket) ? free_bucket : b;
+		}
+		if (MEMBERSET_DELETED == *b) {
+			if (NULL == free_bucket) {
+				free_bucket = b;
+			}
+		} else if (strcmp (set->names[*b - 1], name) == 0) {
+			return b;
+		}
+		i = (i + 1) & mask;
+	}
+}
+
+static int memberset_rehash (struct memberset *set, size_t nbuckets)
+{
+	size_t *buckets;
+	size_t i, n;
+
+	buckets = (size_t *) calloc (nbuckets, sizeof (size_t));
+	if (NULL == buckets) {
+		errno = ENOMEM;
+		return -1;
+	}
+	free (set->buckets);
+	set->buckets = buckets;
+	set->nbuckets = nbuckets;
+
+	/* Squeeze out the holes left by memberset_del() */
+	for (i = 0, n = 0; i < set->used; i++) {
+		if (NULL != set->names[i]) {
+			set->names[n] = set->names[i];
+			n++;
+		}
+	}
+	set->used = n;
+
+	for (i = 0; i < set->used; i++) {
+		*memberset_bucket (set, set->names[i]) = i + 1;
+	}
+	return 0;
+}
+
+/*
+ * memberset_new - create a member set from a NULL terminated list
+ *
+ *	list may be NULL for an empty set. Duplicated names of the list
+ *	are only added once. The names are copied.
+ *
+ *	Return NULL on failure (errno set).
+ */
+/*@null@*/ /*@only@*/struct memberset *memberset_new (/*@null@*/char *const *list)
+{
+	struct memberset *set;
+	size_t n = 0;
+
+	if (NULL != list) {
+		for (n = 0; NULL != list[n]; n++);
+	}
+
+	set = (struct memberset *) calloc (1, sizeof *set);
+	if (NULL == set) {
+		errno = ENOMEM;
+		return NULL;
+	}
+	set->alloc = (n < 8) ? 8 : n;
+	set->names = (char **) malloc (set->alloc * sizeof (char *));
+	if (NULL == set->names) {
+		free (set);
+		errno = ENOMEM;
+		return NULL;
+	}
+	set->nbuckets = 16;
+	while (set->nbuckets < 2 * set->alloc) {
+		set->nbuckets *= 2;
+	}
+	set->buckets = (size_t *) calloc (set->nbuckets, sizeof (size_t));
+	if (NULL == set->buckets) {
+		memberset_free (set);
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	for (; (NULL != list) && (NULL != *list); list++) {
+		if (memberset_add (set, *list) == -1) {
+			memberset_free (set);
+			return NULL;
+		}
+	}
+
+	return set;
+}
+
+void memberset_free (/*@only@*/struct memberset *set)
+{
+	size_t i;
+
+	for (i = 0; i < set->used; i++) {
+		free (set->names[i]);
+	}
+	free (set->names);
+	free (set->buckets);
+	free (set);
+}
+
+bool memberset_contains (const struct memberset *set, const char *member)
+{
+	size_t b = *memberset_bucket (set, member);
+
+	return (0 != b) && (MEMBERSET_DELETED != b);
+}
+
+size_t memberset_count (const struct memberset *set)
+{
+	return set->count;
+}
+
+/*
+ * memberset_add - add a member to a member set
+ *
+ *	Return 1 if the member was added, 0 if it was already in the set,
+ *	and -1 on failure (errno set).
+ */
+int memberset_add (struct memberset *set, const char *member)
+{
+	size_t *b;
+
+	b = memberset_bucket (set, member);
+	if ((0 != *b) && (MEMBERSET_DELETED != *b)) {
+		return 0;
+	}
+
+	/*
+	 * Keep the load factor of the hash table below 1/2. Deleted
+	 * buckets and holes are dropped when the table is rebuilt.
+	 */
+	if (2 * (set->used + 1) > set->nbuckets) {
+		size_t nbuckets = set->nbuckets;
+
+		if (4 * (set->count + 1) > nbuckets) {
+			nbuckets *= 2;
+		}
+		if (memberset_rehash (set, nbuckets) == -1) {
+			return -1;
+		}
+		b = memberset_bucket (set, member);
+	}
+
+	if (set->used == set->alloc) {
+		char **names;
+
+		names = (char **) realloc (set->names,
+		                           2 * set->alloc * sizeof (char *));
+		if (NULL == names) {
+			errno = ENOMEM;
+			return -1;
+		}
+		set->names = names;
+		set->alloc *= 2;
+	}
+
+	set->names[set->used] = strdup (member);
+	if (NULL == set->names[set->used]) {
+		errno = ENOMEM;
+		return -1;
+	}
+	set->used++;
+	*b = set->used;
+	set->count++;
+
+	return 1;
+}
+
+/*
+ * memberset_del - remove a member from a member set
+ *
+ *	Return true if the member was in the set.
+ */
+bool memberset_del (struct memberset *set, const char *member)
+{
+	size_t *b;
+
+	b = memberset_bucket (set, member);
+	if ((0 == *b) || (MEMBERSET_DELETED == *b)) {
+		return false;
+	}
+
+	free (set->names[*b - 1]);
+	set->names[*b - 1] = NULL;
+	*b = MEMBERSET_DELETED;
+	set->count--;
+
+	return true;
+}
+
+/*
+ * memberset_list - materialize a member set into a list of members
+ *
+ *	Return a newly allocated NULL terminated list, with the members
+ *	in the order of their insertion in the set, or NULL on failure
+ *	(errno set).
+ *	The list can be freed like gr_mem/sg_mem lists.
+ */
+/*@null@*/ /*@only@*/char **memberset_list (const struct memberset *set)
+{
+	char **list;
+	size_t i, n;
+
+	list = (char **) malloc ((set->count + 1) * sizeof (char *));
+	if (NULL == list) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	for (i = 0, n = 0; i < set->used; i++) {
+		if (NULL == set->names[i]) {
+			continue;
+		}
+		list[n] = strdup (set->names[i]);
+		if (NULL == list[n]) {
+			while (n > 0) {
+				n--;
+				free (list[n]);
+			}
+			free (list);
+			errno = ENOMEM;
+			return NULL;
+		}
+		n++;
+	}
+	list[n] = NULL;
+
+	return list;
+}
+
+/*
+ * gr_set_members - replace the members of a group by a member set
+ *
+ *	The previous gr_mem list is freed. It must have been allocated
+ *	(e.g. by __gr_dup()).
+ *
+ *	Return false on failure (errno set). grp is not modified in that
+ *	case.
+ */
+bool gr_set_members (struct group *grp, const struct memberset *set)
+{
+	char **list;
+
+	list = memberset_list (set);
+	if (NULL == list) {
+		return false;
+	}
+	gr_free_members (grp);
+	grp->gr_mem = list;
+	return true;
+}
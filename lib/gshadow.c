@@ -80,30 +80,32 @@ static int bind_nis (void)
 
 static /*@null@*/char **build_list (char *s, char **list[], size_t * nlist)
 {
-	char **ptr = *list;
-	size_t nelem = *nlist, size;
+	char **ptr;
+	size_t nelem = *nlist, n;
+	char *cp;
+
+	/* Count the elements first, to allocate the list once */
+	n = nelem + 2;
+	for (cp = s; (NULL != cp) && (NULL != (cp = strchr (cp, ','))); cp++) {
+		n++;
+	}
+	ptr = realloc (*list, n * sizeof (*ptr));
+	if (NULL == ptr) {
+		return NULL;
+	}
+	*list = ptr;
 
 	while (s != NULL && *s != '\0') {
-		size = (nelem + 1) * sizeof (ptr);
-		ptr = realloc (*list, size);
-		if (NULL != ptr) {
-			ptr[nelem] = s;
-			nelem++;
-			*list = ptr;
-			*nlist = nelem;
-			s = strchr (s, ',');
-			if (NULL != s) {
-				*s = '\0';
-				s++;
-			}
+		ptr[nelem] = s;
+		nelem++;
+		s = strchr (s, ',');
+		if (NULL != s) {
+			*s = '\0';
+			s++;
 		}
 	}
-	size = (nelem + 1) * sizeof (ptr);
-	ptr = realloc (*list, size);
-	if (NULL != ptr) {
-		ptr[nelem] = NULL;
-		*list = ptr;
-	}
+	ptr[nelem] = NULL;
+	*nlist = nelem;
 	return ptr;
 }
 
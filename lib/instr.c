@@ -0,0 +1,300 @@
+#include <config.h>
+
+#ident "$Id$"
+
+#include <sys/types.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "prototypes.h"
+#include "defines.h"
+
+/*
+ * Instrumentation
+ *
+ * When the SHADOW_INSTRUMENT environment variable is set, the time spent
+ * in the main phases of a tool (locking, parsing and writing the
+ * databases, NSS lookups, password hashing, tree walks) and a few
+ * counters are collected, and reported as a JSON object when the tool
+ * exits.
+ *
+ * SHADOW_INSTRUMENT is either "syslog", or the number of a file
+ * descriptor inherited from the caller. File descriptors are not
+ * accepted by set-ID programs, which only report to syslog.
+ *
+ * The report looks like:
+ *
+ *	{"prog":"useradd","pid":42,"total_us":9123456,
+ *	 "phases":{"commonio_lock":{"count":4,"total_us":9000000,
+ *	                            "max_us":8999000},...},
+ *	 "counters":{"commonio_entries":1024,...}}
+ *
+ * Nested calls of the same phase (e.g. the recursion of copy_tree) are
+ * only accounted for once.
+ */
+
+#define INSTR_MAX	32
+
+struct instr_phase {
+	const char *name;
+	unsigned long count;
+	unsigned long long total_ns;
+	unsigned long long max_ns;
+	unsigned int depth;
+};
+
+struct instr_counter {
+	const char *name;
+	unsigned long long value;
+};
+
+static int instr_state = -1;	/* -1: unknown, 0: disabled, 1: enabled */
+static int instr_fd = -1;	/* -1: syslog */
+static pid_t instr_pid;		/* children do not report */
+static struct timespec instr_start;
+static struct instr_phase phases[INSTR_MAX];
+static size_t nphases = 0;
+static struct instr_counter counters[INSTR_MAX];
+static size_t ncounters = 0;
+
+static unsigned long long instr_elapsed (const struct timespec *start)
+{
+	struct timespec now;
+
+	if (clock_gettime (CLOCK_MONOTONIC, &now) != 0) {
+		return 0;
+	}
+	return   (unsigned long long) (now.tv_sec - start->tv_sec) * 1000000000ULL
+	       + (unsigned long long) now.tv_nsec
+	       - (unsigned long long) start->tv_nsec;
+}
+
+/*
+ * Append a formatted string to the report, truncating it if needed.
+ */
+static void instr_append (char *buf, size_t size, size_t *len,
+                          const char *fmt, ...)
+	__attribute__ ((format (printf, 4, 5)));
+
+static void instr_append (char *buf, size_t size, size_t *len,
+                          const char *fmt, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (*len >= size) {
+		return;
+	}
+	va_start (ap, fmt);
+	ret = vsnprintf (buf + *len, size - *len, fmt, ap);
+	va_end (ap);
+	if (ret > 0) {
+		*len += (size_t) ret;
+	}
+}
+
+static void instr_report (void)
+{
+	char buf[4096];
+	size_t len = 0;
+	const char *cp;
+	size_t i;
+
+	if (getpid () != instr_pid) {
+		return;
+	}
+
+	instr_append (buf, sizeof buf, &len, "{\"prog\":\"");
+	for (cp = (NULL != Prog) ? Prog : ""; '\0' != *cp; cp++) {
+		if (('"' == *cp) || ('\\' == *cp)) {
+			instr_append (buf, sizeof buf, &len, "\\%c", *cp);
+		} else if ((unsigned char) *cp < 0x20) {
+			instr_append (buf, sizeof buf, &len, "\\u%04x",
+			              (unsigned int) (unsigned char) *cp);
+		} else {
+			instr_append (buf, sizeof buf, &len, "%c", *cp);
+		}
+	}
+	instr_append (buf, sizeof buf, &len,
+	              "\",\"pid\":%lu,\"total_us\":%llu,\"phases\":{",
+	              (unsigned long) instr_pid,
+	              instr_elapsed (&instr_start) / 1000);
+	for (i = 0; i < nphases; i++) {
+		instr_append (buf, sizeof buf, &len,
+		              "%s\"%s\":{\"count\":%lu,\"total_us\":%llu,"
+		              "\"max_us\":%llu}",
+		              (0 != i) ? "," : "",
+		              phases[i].name, phases[i].count,
+		              phases[i].total_ns / 1000,
+		              phases[i].max_ns / 1000);
+	}
+	instr_append (buf, sizeof buf, &len, "},\"counters\":{");
+	for (i = 0; i < ncounters; i++) {
+		instr_append (buf, sizeof buf, &len, "%s\"%s\":%llu",
+		              (0 != i) ? "," : "",
+		              counters[i].name, counters[i].value);
+	}
+	instr_append (buf, sizeof buf, &len, "}}\n");
+	if (len >= sizeof buf) {
+		/* Truncated; the report is still one line */
+		len = sizeof buf - 1;
+		buf[len - 1] = '\n';
+	}
+
+	if (-1 == instr_fd) {
+		buf[len - 1] = '\0';
+		SYSLOG ((LOG_INFO, "%s", buf));
+	} else {
+		cp = buf;
+		while (len > 0) {
+			ssize_t n = write (instr_fd, cp, len);
+
+			if (n < 0) {
+				if (EINTR == errno) {
+					continue;
+				}
+				break;
+			}
+			cp += n;
+			len -= (size_t) n;
+		}
+	}
+}
+
+static bool instr_enabled (void)
+{
+	const char *env;
+
+	if (-1 != instr_state) {
+		return (1 == instr_state);
+	}
+
+	instr_state = 0;
+	env = getenv ("SHADOW_INSTRUMENT");
+	if ((NULL == env) || ('\0' == *env)) {
+		return false;
+	}
+	if (strcmp (env, "syslog") != 0) {
+		long fd;
+
+		if (   (getlong (env, &fd) == 0)
+		    || (fd < 0)
+		    || (fd > INT_MAX)
+		    || (getuid () != geteuid ())
+		    || (getgid () != getegid ())) {
+			return false;
+		}
+		/*
+		 * Duplicate the descriptor now, so that the report cannot
+		 * end in a file opened later by the tool with the same
+		 * number.
+		 */
+		instr_fd = fcntl ((int) fd, F_DUPFD_CLOEXEC, 3);
+		if (-1 == instr_fd) {
+			return false;
+		}
+	}
+
+	if (   (clock_gettime (CLOCK_MONOTONIC, &instr_start) != 0)
+	    || (atexit (instr_report) != 0)) {
+		if (-1 != instr_fd) {
+			(void) close (instr_fd);
+			instr_fd = -1;
+		}
+		return false;
+	}
+	instr_pid = getpid ();
+	instr_state = 1;
+	return true;
+}
+
+static /*@null@*/struct instr_phase *instr_phase (const char *name)
+{
+	size_t i;
+
+	for (i = 0; i < nphases; i++) {
+		if (   (phases[i].name == name)
+		    || (strcmp (phases[i].name, name) == 0)) {
+			return &phases[i];
+		}
+	}
+	if (nphases == INSTR_MAX) {
+		return NULL;
+	}
+	phases[nphases].name = name;
+	nphases++;
+	return &phases[nphases - 1];
+}
+
+/*
+ * instr_begin - start timing a phase
+ *
+ *	name shall be a static string. It is not copied.
+ */
+void instr_begin (/*@out@*/struct instr_mark *mark, const char *name)
+{
+	mark->phase = NULL;
+	if (!instr_enabled ()) {
+		return;
+	}
+	mark->phase = instr_phase (name);
+	if (NULL == mark->phase) {
+		return;
+	}
+	mark->phase->depth++;
+	if (   (1 != mark->phase->depth)
+	    || (clock_gettime (CLOCK_MONOTONIC, &mark->start) != 0)) {
+		mark->phase->depth--;
+		mark->phase = NULL;
+	}
+}
+
+/*
+ * instr_end - stop timing a phase started with instr_begin()
+ */
+void instr_end (const struct instr_mark *mark)
+{
+	unsigned long long ns;
+
+	if (NULL == mark->phase) {
+		return;
+	}
+	ns = instr_elapsed (&mark->start);
+	mark->phase->depth--;
+	mark->phase->count++;
+	mark->phase->total_ns += ns;
+	if (ns > mark->phase->max_ns) {
+		mark->phase->max_ns = ns;
+	}
+}
+
+/*
+ * instr_count - increment a counter
+ *
+ *	name shall be a static string. It is not copied.
+ */
+void instr_count (const char *name, unsigned long n)
+{
+	size_t i;
+
+	if (!instr_enabled ()) {
+		return;
+	}
+	for (i = 0; i < ncounters; i++) {
+		if (   (counters[i].name == name)
+		    || (strcmp (counters[i].name, name) == 0)) {
+			counters[i].value += n;
+			return;
+		}
+	}
+	if (ncounters < INSTR_MAX) {
+		counters[ncounters].name = name;
+		counters[ncounters].value = n;
+		ncounters++;
+	}
+}
@@ -0,0 +1,270 @@
+#include <config.h>
+
+#ident "$Id$"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "prototypes.h"
+#include "defines.h"
+
+/*
+ * Name tables
+ *
+ * Small configuration files read on every login (the consoles file, the
+ * hushed logins file, the tty types file) are lists of names, sometimes
+ * with a value. Instead of reading them line by line on every login,
+ * they are compiled into a hash table of their names, which is cached in
+ * CACHE_DIR until the file changes:
+ *
+ *	struct nametable_db
+ *	uint32_t buckets[nbuckets]	index + 1 of the first entry
+ *	struct nametable_entry entries[nentries]
+ *	char strings[strings_len]
+ *
+ * Only the first line of a name is kept.
+ */
+#define NAMETABLE_MAGIC	"names1"
+
+struct nametable_db {
+	uint32_t nbuckets;	/* power of 2 */
+	uint32_t nentries;
+	uint32_t strings_len;
+};
+
+struct nametable_entry {
+	uint32_t name;		/* offset in strings */
+	uint32_t value;		/* offset in strings */
+	uint32_t next;		/* index + 1 of the next entry in the bucket */
+};
+
+struct nametable {
+	const void *db;
+	size_t len;
+	bool mapped;
+};
+
+static bool nametable_valid (const void *db, size_t len)
+{
+	const struct nametable_db *hdr = db;
+
+	return    (len >= sizeof *hdr)
+	       && (0 != hdr->nbuckets)
+	       && ((hdr->nbuckets & (hdr->nbuckets - 1)) == 0)
+	       && (len == sizeof *hdr
+	                  + (size_t) hdr->nbuckets * sizeof (uint32_t)
+	                  + (size_t) hdr->nentries
+	                    * sizeof (struct nametable_entry)
+	                  + hdr->strings_len)
+	       && (   (0 == hdr->strings_len)
+	           || ('\0' == ((const char *) db)[len - 1]));
+}
+
+/*
+ * Compile a file of names.
+ *
+ * Return the compiled file (to be freed by the caller) and store its
+ * length in *len, or return NULL on failure.
+ */
+static /*@null@*/void *nametable_compile (FILE *fp, nametable_parse parse,
+                                          size_t *len)
+{
+	char buf[BUFSIZ];
+	struct cache_buf lines = { NULL, 0, 0 };
+	struct cache_buf strings = { NULL, 0, 0 };
+	struct nametable_entry *entries = NULL;
+	uint32_t *buckets = NULL;
+	struct nametable_db hdr;
+	uint32_t nlines = 0;
+	uint32_t i;
+	char *db = NULL;
+	const char *cp;
+
+	memzero (&hdr, sizeof hdr);
+
+	/* First, collect the names and values */
+	while (fgets (buf, (int) sizeof buf, fp) == buf) {
+		const char *name;
+		const char *value = "";
+
+		if (!parse (buf, &name, &value)) {
+			continue;
+		}
+		if (   (cache_buf_add (&lines, name, strlen (name) + 1) != 0)
+		    || (cache_buf_add (&lines, value, strlen (value) + 1) != 0)) {
+			goto fail;
+		}
+		nlines++;
+	}
+	if (ferror (fp) != 0) {
+		goto fail;
+	}
+
+	hdr.nbuckets = 16;
+	while (hdr.nbuckets < 2 * nlines) {
+		hdr.nbuckets *= 2;
+	}
+	buckets = calloc (hdr.nbuckets, sizeof *buckets);
+	entries = calloc (nlines + 1, sizeof *entries);
+	if ((NULL == buckets) || (NULL == entries)) {
+		goto fail;
+	}
+
+	/* Then build the hash table */
+	for (cp = lines.data, i = 0; i < nlines; i++) {
+		uint32_t *b;
+		const char *lname, *lvalue;
+		struct nametable_entry *e;
+
+		lname = cp;
+		lvalue = lname + strlen (lname) + 1;
+		cp = lvalue + strlen (lvalue) + 1;
+
+		b = &buckets[commonio_hash (lname) & (hdr.nbuckets - 1)];
+		for (e = (0 != *b) ? &entries[*b - 1] : NULL;
+		     NULL != e;
+		     e = (0 != e->next) ? &entries[e->next - 1] : NULL) {
+			if (strcmp (strings.data + e->name, lname) == 0) {
+				break;
+			}
+		}
+		if (NULL != e) {
+			/* Only the first line of a name is considered */
+			continue;
+		}
+
+		e = &entries[hdr.nentries];
+		hdr.nentries++;
+		e->name = (uint32_t) strings.len;
+		if (cache_buf_add (&strings, lname, strlen (lname) + 1) != 0) {
+			goto fail;
+		}
+		e->value = (uint32_t) strings.len;
+		if (cache_buf_add (&strings, lvalue, strlen (lvalue) + 1) != 0) {
+			goto fail;
+		}
+		e->next = *b;
+		*b = hdr.nentries;
+	}
+	hdr.strings_len = (uint32_t) strings.len;
+
+	*len = sizeof hdr
+	       + hdr.nbuckets * sizeof *buckets
+	       + hdr.nentries * sizeof *entries
+	       + strings.len;
+	db = malloc (*len);
+	if (NULL != db) {
+		char *p = db;
+
+		memcpy (p, &hdr, sizeof hdr);
+		p += sizeof hdr;
+		memcpy (p, buckets, hdr.nbuckets * sizeof *buckets);
+		p += hdr.nbuckets * sizeof *buckets;
+		memcpy (p, entries, hdr.nentries * sizeof *entries);
+		p += hdr.nentries * sizeof *entries;
+		if (0 != strings.len) {
+			memcpy (p, strings.data, strings.len);
+		}
+	}
+
+      fail:
+	free (lines.data);
+	free (strings.data);
+	free (entries);
+	free (buckets);
+	return db;
+}
+
+/*
+ * nametable_load - load the name table of a file
+ *
+ *	fp is the file, opened by the caller. cache is the name of the
+ *	cache of the file in CACHE_DIR. parse extracts the name and value
+ *	(if any) of a line; it returns false for the lines to ignore.
+ *
+ *	The table is taken from the cache if it is up to date, otherwise
+ *	the file is compiled, and the cache updated.
+ *
+ *	Return NULL on failure.
+ */
+/*@null@*/ /*@only@*/struct nametable *nametable_load (FILE *fp,
+                                                      const char *cache,
+                                                      nametable_parse parse)
+{
+	struct nametable *table;
+	struct stat sb;
+
+	if (fstat (fileno (fp), &sb) != 0) {
+		return NULL;
+	}
+	table = malloc (sizeof *table);
+	if (NULL == table) {
+		return NULL;
+	}
+
+	table->db = cache_map (cache, NAMETABLE_MAGIC, &sb, &table->len);
+	if (NULL != table->db) {
+		if (nametable_valid (table->db, table->len)) {
+			table->mapped = true;
+			return table;
+		}
+		cache_unmap (table->db, table->len);
+	}
+
+	table->db = nametable_compile (fp, parse, &table->len);
+	if (NULL == table->db) {
+		free (table);
+		return NULL;
+	}
+	table->mapped = false;
+	(void) cache_write (cache, NAMETABLE_MAGIC, &sb, table->db, table->len);
+	return table;
+}
+
+/*
+ * nametable_find - look up a name
+ *
+ *	Return the value of the name ("" if the file gives no value), or
+ *	NULL if the name is not listed.
+ */
+/*@null@*/ /*@observer@*/const char *nametable_find (
+	const struct nametable *table,
+	const char *name)
+{
+	const struct nametable_db *hdr = table->db;
+	const uint32_t *buckets = (const uint32_t *) (hdr + 1);
+	const struct nametable_entry *entries =
+		(const struct nametable_entry *) (buckets + hdr->nbuckets);
+	const char *strings = (const char *) (entries + hdr->nentries);
+	uint32_t i;
+
+	i = buckets[commonio_hash (name) & (hdr->nbuckets - 1)];
+	while ((0 != i) && (i <= hdr->nentries)) {
+		const struct nametable_entry *e = &entries[i - 1];
+
+		if (   (e->name >= hdr->strings_len)
+		    || (e->value >= hdr->strings_len)) {
+			return NULL;
+		}
+		if (strcmp (strings + e->name, name) == 0) {
+			return strings + e->value;
+		}
+		i = e->next;
+	}
+	return NULL;
+}
+
+/*
+ * nametable_free - release a name table
+ */
+void nametable_free (/*@only@*/struct nametable *table)
+{
+	if (table->mapped) {
+		cache_unmap (table->db, table->len);
+	} else {
+		free ((void *) table->db);
+	}
+	free (table);
+}
@@ -4,8 +4,14 @@
 #ifdef USE_NSCD
 
 #include <stdio.h>
+#include <errno.h>
+#include <stdint.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
 #include <sys/wait.h>
 #include <sys/types.h>
+#include <unistd.h>
 #include "exitcodes.h"
 #include "defines.h"
 #include "prototypes.h"
@@ -14,9 +20,93 @@
 #define MSG_NSCD_FLUSH_CACHE_FAILED "%s: Failed to flush the nscd cache.\n"
 
 /*
- * nscd_flush_cache - flush specified service buffer in nscd cache
+ * The invalidation request of nscd, as sent by nscd -i: a request header
+ * followed by the name of the database (with its NUL).
  */
-int nscd_flush_cache (const char *service)
+#define NSCD_SOCKET	"/var/run/nscd/socket"
+#define NSCD_VERSION	2
+#define NSCD_INVALIDATE	10
+
+struct nscd_request {
+	int32_t version;
+	int32_t type;
+	int32_t key_len;
+};
+
+/*
+ * Ask nscd to invalidate a database through its socket.
+ *
+ * Return 0 on success or if nscd is not running, -1 if nscd could not
+ * be reached (errno set), or 1 if nscd refused the request.
+ */
+static int nscd_invalidate (const char *service)
+{
+	struct sockaddr_un addr;
+	struct nscd_request req;
+	struct iovec iov[2];
+	int32_t resp;
+	ssize_t n;
+	int fd;
+
+	fd = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (fd < 0) {
+		return -1;
+	}
+	memzero (&addr, sizeof addr);
+	addr.sun_family = AF_UNIX;
+	strcpy (addr.sun_path, NSCD_SOCKET);
+	if (connect (fd, (struct sockaddr *) &addr, sizeof addr) != 0) {
+		int saved_errno = errno;
+
+		(void) close (fd);
+		if (   (ENOENT == saved_errno)
+		    || (ECONNREFUSED == saved_errno)) {
+			/* nscd is not running */
+			return 0;
+		}
+		errno = saved_errno;
+		return -1;
+	}
+
+	req.version = NSCD_VERSION;
+	req.type = NSCD_INVALIDATE;
+	req.key_len = (int32_t) strlen (service) + 1;
+	iov[0].iov_base = &req;
+	iov[0].iov_len = sizeof req;
+	iov[1].iov_base = (char *) service;
+	iov[1].iov_len = (size_t) req.key_len;
+	do {
+		n = writev (fd, iov, 2);
+	} while ((-1 == n) && (EINTR == errno));
+	if (n != (ssize_t) (sizeof req + (size_t) req.key_len)) {
+		goto fail;
+	}
+	do {
+		n = read (fd, &resp, sizeof resp);
+	} while ((-1 == n) && (EINTR == errno));
+	if (n != (ssize_t) sizeof resp) {
+		goto fail;
+	}
+	(void) close (fd);
+	return (0 == resp) ? 0 : 1;
+
+      fail:
+	if (n >= 0) {
+		errno = EPROTO;
+	}
+	{
+		int saved_errno = errno;
+		(void) close (fd);
+		errno = saved_errno;
+	}
+	return -1;
+}
+
+/*
+ * Flush the cache with nscd -i, if it could not be done through the
+ * socket.
+ */
+static int nscd_run_flush (const char *service)
 {
 	int status, code;
 	const char *cmd = "/usr/sbin/nscd";
@@ -51,6 +141,35 @@ int nscd_flush_cache (const char *service)
 
 	return 0;
 }
+
+/*
+ * nscd_flush_cache - flush specified service buffer in nscd cache
+ *
+ *	The request is sent to nscd through its socket. nscd only
+ *	invalidates whole databases.
+ *
+ *	If CACHE_FLUSH_DELAY is set, the flush is deferred, and merged
+ *	with the flushes requested in the meantime (see cache_flush_defer).
+ */
+int nscd_flush_cache (const char *service)
+{
+	int ret;
+
+	if (cache_flush_defer_nscd (service)) {
+		return 0;
+	}
+
+	ret = nscd_invalidate (service);
+	if (0 == ret) {
+		return 0;
+	}
+	if (1 == ret) {
+		(void) fprintf (shadow_logfd, _(MSG_NSCD_FLUSH_CACHE_FAILED), Prog);
+		return -1;
+	}
+	/* The socket protocol did not work, try nscd itself */
+	return nscd_run_flush (service);
+}
 #else				/* USE_NSCD */
 extern int errno;		/* warning: ANSI C forbids an empty source file */
 #endif				/* USE_NSCD */
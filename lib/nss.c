@@ -6,10 +6,14 @@
 #include <strings.h>
 #include <ctype.h>
 #include <stdatomic.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include "prototypes.h"
 #include "../libsubid/subid.h"
 
 #define NSSWITCH "/etc/nsswitch.conf"
+#define NSSWITCH_CACHE "nsswitch-subid"
+#define NSSWITCH_MAGIC "subid1"
 
 // NSS plugin handling for subids
 // If nsswitch has a line like
@@ -19,7 +23,9 @@
 // the subids are a pretty limited resource, and local files seem
 // bound to step on any other allocations leading to insecure
 // conditions.
-static atomic_flag nss_init_started;
+// The first thread calling nss_init() reads nsswitch.conf with
+// nss_init_lock held, the others block on it until the module is loaded.
+static pthread_mutex_t nss_init_lock = PTHREAD_MUTEX_INITIALIZER;
 static atomic_bool nss_init_completed;
 
 static struct subid_nss_ops *subid_nss;
@@ -36,30 +42,15 @@ void nss_exit() {
 	}
 }
 
-// nsswitch_path is an argument only to support testing.
-void nss_init(char *nsswitch_path) {
-	FILE *nssfp = NULL;
+// read_subid_module: return the first module of the subid: line of
+// nsswitch.conf, or "" if there is none.  Returns NULL on failure.
+static char *read_subid_module(FILE *nssfp) {
 	char *line = NULL, *p, *token, *saveptr;
+	char *module = NULL;
 	size_t len = 0;
 
-	if (atomic_flag_test_and_set(&nss_init_started)) {
-		// Another thread has started nss_init, wait for it to complete
-		while (!atomic_load(&nss_init_completed))
-			usleep(100);
-		return;
-	}
-
-	if (!nsswitch_path)
-		nsswitch_path = NSSWITCH;
-
-	// read nsswitch.conf to check for a line like:
+	// check for a line like:
 	//   subid:	files
-	nssfp = fopen(nsswitch_path, "r");
-	if (!nssfp) {
-		fprintf(shadow_logfd, "Failed opening %s: %m", nsswitch_path);
-		atomic_store(&nss_init_completed, true);
-		return;
-	}
 	while ((getline(&line, &len, nssfp)) != -1) {
 		if (line[0] == '\0' || line[0] == '#')
 			continue;
@@ -72,75 +63,131 @@ void nss_init(char *nsswitch_path) {
 			p++;
 		if (!*p)
 			continue;
-		for (token = strtok_r(p, " \n\t", &saveptr);
-		     token;
-		     token = strtok_r(NULL, " \n\t", &saveptr)) {
-			char libname[65];
-			void *h;
-			if (strcmp(token, "files") == 0) {
-				subid_nss = NULL;
-				goto done;
-			}
-			if (strlen(token) > 50) {
-				fprintf(shadow_logfd, "Subid NSS module name too long (longer than 50 characters): %s\n", token);
-				fprintf(shadow_logfd, "Using files\n");
-				subid_nss = NULL;
-				goto done;
-			}
-			snprintf(libname, 64,  "libsubid_%s.so", token);
-			h = dlopen(libname, RTLD_LAZY);
-			if (!h) {
-				fprintf(shadow_logfd, "Error opening %s: %s\n", libname, dlerror());
-				fprintf(shadow_logfd, "Using files\n");
-				subid_nss = NULL;
-				goto done;
-			}
-			subid_nss = malloc(sizeof(*subid_nss));
-			if (!subid_nss) {
-				dlclose(h);
-				goto done;
-			}
-			subid_nss->has_range = dlsym(h, "shadow_subid_has_range");
-			if (!subid_nss->has_range) {
-				fprintf(shadow_logfd, "%s did not provide @has_range@\n", libname);
-				dlclose(h);
-				free(subid_nss);
-				subid_nss = NULL;
-				goto done;
-			}
-			subid_nss->list_owner_ranges = dlsym(h, "shadow_subid_list_owner_ranges");
-			if (!subid_nss->list_owner_ranges) {
-				fprintf(shadow_logfd, "%s did not provide @list_owner_ranges@\n", libname);
-				dlclose(h);
-				free(subid_nss);
-				subid_nss = NULL;
-				goto done;
-			}
-			subid_nss->find_subid_owners = dlsym(h, "shadow_subid_find_subid_owners");
-			if (!subid_nss->find_subid_owners) {
-				fprintf(shadow_logfd, "%s did not provide @find_subid_owners@\n", libname);
-				dlclose(h);
-				free(subid_nss);
-				subid_nss = NULL;
-				goto done;
+		token = strtok_r(p, " \n\t", &saveptr);
+		if (!token)
+			continue;
+		module = strdup(token);
+		free(line);
+		return module;
+	}
+	free(line);
+	return strdup("");
+}
+
+// subid_module: same as read_subid_module() for the nsswitch_path file.
+//
+// The result for /etc/nsswitch.conf is cached in CACHE_DIR, and only
+// parsed again when the file changes.
+static char *subid_module(const char *nsswitch_path) {
+	FILE *nssfp;
+	struct stat sb;
+	bool use_cache;
+	char *module;
+
+	nssfp = fopen(nsswitch_path, "r");
+	if (!nssfp) {
+		fprintf(shadow_logfd, "Failed opening %s: %m", nsswitch_path);
+		return NULL;
+	}
+
+	use_cache = (strcmp(nsswitch_path, NSSWITCH) == 0)
+	            && (fstat(fileno(nssfp), &sb) == 0);
+	if (use_cache) {
+		const void *cached;
+		size_t len;
+
+		cached = cache_map(NSSWITCH_CACHE, NSSWITCH_MAGIC, &sb, &len);
+		if (cached) {
+			module = strndup(cached, len);
+			cache_unmap(cached, len);
+			if (module) {
+				fclose(nssfp);
+				return module;
 			}
-			subid_nss->handle = h;
-			goto done;
 		}
-		fprintf(shadow_logfd, "No usable subid NSS module found, using files\n");
-		// subid_nss has to be null here, but to ease reviews:
-		free(subid_nss);
-		subid_nss = NULL;
+	}
+
+	module = read_subid_module(nssfp);
+	fclose(nssfp);
+	if (module && use_cache)
+		(void) cache_write(NSSWITCH_CACHE, NSSWITCH_MAGIC, &sb,
+		                   module, strlen(module));
+	return module;
+}
+
+// nsswitch_path is an argument only to support testing.
+void nss_init(char *nsswitch_path) {
+	char *module;
+	char libname[65];
+	void *h;
+
+	if (atomic_load(&nss_init_completed))
+		return;
+	pthread_mutex_lock(&nss_init_lock);
+	if (atomic_load(&nss_init_completed)) {
+		// Another thread did it while we were waiting
+		pthread_mutex_unlock(&nss_init_lock);
+		return;
+	}
+
+	if (!nsswitch_path)
+		nsswitch_path = NSSWITCH;
+
+	subid_nss = NULL;
+	module = subid_module(nsswitch_path);
+	if (!module || module[0] == '\0' || strcmp(module, "files") == 0)
+		goto done;
+	if (strlen(module) > 50) {
+		fprintf(shadow_logfd, "Subid NSS module name too long (longer than 50 characters): %s\n", module);
+		fprintf(shadow_logfd, "Using files\n");
+		goto done;
+	}
+	snprintf(libname, 64,  "libsubid_%s.so", module);
+	// The symbols of the module are bound lazily. Setting LD_BIND_NOW
+	// binds them now, so that a module with unresolved symbols is
+	// rejected here, rather than failing in the middle of a query.
+	h = dlopen(libname, RTLD_LAZY);
+	if (!h) {
+		fprintf(shadow_logfd, "Error opening %s: %s\n", libname, dlerror());
+		fprintf(shadow_logfd, "Using files\n");
 		goto done;
 	}
+	subid_nss = malloc(sizeof(*subid_nss));
+	if (!subid_nss) {
+		dlclose(h);
+		goto done;
+	}
+	subid_nss->has_range = dlsym(h, "shadow_subid_has_range");
+	if (!subid_nss->has_range) {
+		fprintf(shadow_logfd, "%s did not provide @has_range@\n", libname);
+		goto fail;
+	}
+	subid_nss->list_owner_ranges = dlsym(h, "shadow_subid_list_owner_ranges");
+	if (!subid_nss->list_owner_ranges) {
+		fprintf(shadow_logfd, "%s did not provide @list_owner_ranges@\n", libname);
+		goto fail;
+	}
+	subid_nss->find_subid_owners = dlsym(h, "shadow_subid_find_subid_owners");
+	if (!subid_nss->find_subid_owners) {
+		fprintf(shadow_logfd, "%s did not provide @find_subid_owners@\n", libname);
+		goto fail;
+	}
+	/* The batch queries are optional */
+	subid_nss->list_owners_ranges = dlsym(h, "shadow_subid_list_owners_ranges");
+	subid_nss->find_ids_owners = dlsym(h, "shadow_subid_find_ids_owners");
+	subid_nss->list_all_ranges = dlsym(h, "shadow_subid_list_all_ranges");
+	subid_nss->handle = h;
+	atexit(nss_exit);
+	goto done;
 
+fail:
+	dlclose(h);
+	free(subid_nss);
+	subid_nss = NULL;
 done:
+	free(module);
 	atomic_store(&nss_init_completed, true);
-	free(line);
-	if (nssfp) {
-		atexit(nss_exit);
-		fclose(nssfp);
-	}
+	pthread_mutex_unlock(&nss_init_lock);
 }
 
 struct subid_nss_ops *get_subid_nss_handle() {
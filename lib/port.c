@@ -37,6 +37,9 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
 #include "defines.h"
 #include "prototypes.h"
 #include "port.h"
@@ -400,37 +403,648 @@ static struct port *getttyuser (const char *tty, const char *user)
 	return port;
 }
 
+
 /*
- * isttytime - tell if a given user may login at a particular time
+ * Compiled ports file
  *
- *	isttytime searches the ports file for an entry which matches
- *	the user name and TTY given.
+ * Searching PORTS line by line for every login, or for every session in
+ * logoutd, does not scale to large files. The file is compiled into a
+ * hash table of its tty names and a hash table of its user names, which
+ * give the (ordered) list of the entries mentioning each name. The tty
+ * names with a '*' cannot be hashed; they are kept in a short list
+ * matched with portcmp(). The compiled file is cached in CACHE_DIR until
+ * PORTS changes:
+ *
+ *	struct port_db
+ *	uint32_t tty_buckets[ntty]	index + 1 of the first tty key
+ *	uint32_t user_buckets[nuser]	index + 1 of the first user key
+ *	struct port_key keys[nkeys]
+ *	uint32_t lists[nlists]		tty and user names of the entries
+ *					(offsets in strings), then entry
+ *					numbers of the keys, in increasing
+ *					order
+ *	struct port_entry entries[nentries]
+ *	struct pt_time times[ntimes]	the times of each entry, terminated
+ *					by t_start == -1
+ *	char strings[strings_len]
+ *
+ * The entry for a user and tty is the first entry listed both by the
+ * keys matching the tty and by the keys of the user and of "*". The
+ * shorter of the two sets of lists is scanned, and the other side is
+ * checked with the names of each candidate entry.
  */
+#define PORT_CACHE	"porttime"
+#define PORT_MAGIC	"porttim1"
+
+struct port_db {
+	uint32_t ntty;		/* power of 2 */
+	uint32_t nuser;		/* power of 2 */
+	uint32_t wild;		/* index + 1 of the first tty key with '*' */
+	uint32_t nkeys;
+	uint32_t nlists;
+	uint32_t nentries;
+	uint32_t ntimes;
+	uint32_t strings_len;
+};
+
+struct port_key {
+	uint32_t name;		/* offset in strings */
+	uint32_t next;		/* index + 1 of the next key in the bucket */
+	uint32_t list;		/* index of the first entry number in lists */
+	uint32_t nlist;
+};
+
+struct port_entry {
+	uint32_t names;		/* index of the first tty name in lists */
+	uint32_t nnames;
+	uint32_t users;		/* index of the first user name in lists */
+	uint32_t nusers;
+	uint32_t times;		/* index of the first time in times */
+};
+
+struct port_view {
+	const struct port_db *hdr;
+	const uint32_t *tty_buckets;
+	const uint32_t *user_buckets;
+	const struct port_key *keys;
+	const uint32_t *lists;
+	const struct port_entry *entries;
+	const struct pt_time *times;
+	const char *strings;
+};
+
+/* The times of an entry without times */
+static const struct pt_time no_times[1] = { { 0, -1, -1 } };
+
+/* The compiled PORTS, loaded by port_reload() */
+static /*@null@*/const void *port_db = NULL;
+static size_t port_db_len = 0;
+static bool port_db_mapped = false;
+static bool port_loaded = false;
+static struct port_view port_v;
+static struct stat port_stat;
 
-bool isttytime (const char *id, const char *port, time_t when)
+/*
+ * Check the size of a compiled ports file and locate its tables.
+ */
+static bool port_view (const void *db, size_t len,
+                       /*@out@*/struct port_view *v)
 {
-	int i;
-	int dtime;
-	struct port *pp;
-	struct tm *tm;
+	const struct port_db *hdr = db;
+
+	if (   (len < sizeof *hdr)
+	    || (0 == hdr->ntty)
+	    || ((hdr->ntty & (hdr->ntty - 1)) != 0)
+	    || (0 == hdr->nuser)
+	    || ((hdr->nuser & (hdr->nuser - 1)) != 0)
+	    || (len != sizeof *hdr
+	               + ((size_t) hdr->ntty + hdr->nuser) * sizeof (uint32_t)
+	               + (size_t) hdr->nkeys * sizeof (struct port_key)
+	               + (size_t) hdr->nlists * sizeof (uint32_t)
+	               + (size_t) hdr->nentries * sizeof (struct port_entry)
+	               + (size_t) hdr->ntimes * sizeof (struct pt_time)
+	               + hdr->strings_len)) {
+		return false;
+	}
+	v->hdr = hdr;
+	v->tty_buckets = (const uint32_t *) (hdr + 1);
+	v->user_buckets = v->tty_buckets + hdr->ntty;
+	v->keys = (const struct port_key *) (v->user_buckets + hdr->nuser);
+	v->lists = (const uint32_t *) (v->keys + hdr->nkeys);
+	v->entries = (const struct port_entry *) (v->lists + hdr->nlists);
+	v->times = (const struct pt_time *) (v->entries + hdr->nentries);
+	v->strings = (const char *) (v->times + hdr->ntimes);
+
+	/* So that the strings and the lists of times are terminated */
+	if (   ((0 != hdr->strings_len)
+	        && ('\0' != v->strings[hdr->strings_len - 1]))
+	    || ((0 != hdr->ntimes)
+	        && (-1 != v->times[hdr->ntimes - 1].t_start))) {
+		return false;
+	}
+	return true;
+}
 
-	/*
-	 * Try to find a matching entry for this user.  Default to
-	 * letting the user in - there are plenty of ways to have an
-	 * entry to match all users.
-	 */
+static /*@null@*/const struct port_key *port_key (const struct port_view *v,
+                                                  uint32_t i)
+{
+	const struct port_key *k;
+
+	if ((0 == i) || (i > v->hdr->nkeys)) {
+		return NULL;
+	}
+	k = &v->keys[i - 1];
+	if (   (k->name >= v->hdr->strings_len)
+	    || (k->list > v->hdr->nlists)
+	    || (k->nlist > v->hdr->nlists - k->list)) {
+		return NULL;
+	}
+	return k;
+}
+
+static /*@null@*/const struct port_key *port_find_key (
+	const struct port_view *v,
+	const uint32_t *buckets,
+	uint32_t nbuckets,
+	const char *name)
+{
+	const struct port_key *k;
+
+	for (k = port_key (v, buckets[commonio_hash (name) & (nbuckets - 1)]);
+	     NULL != k;
+	     k = port_key (v, k->next)) {
+		if (strcmp (v->strings + k->name, name) == 0) {
+			return k;
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Tell if the entry e lists the tty (if tty is not NULL) or the user.
+ */
+static bool port_entry_has (const struct port_view *v, uint32_t e,
+                            /*@null@*/const char *tty, const char *user)
+{
+	const struct port_entry *pe;
+	uint32_t first, n, i;
+
+	if (e >= v->hdr->nentries) {
+		return false;
+	}
+	pe = &v->entries[e];
+	first = (NULL != tty) ? pe->names : pe->users;
+	n = (NULL != tty) ? pe->nnames : pe->nusers;
+	if ((first > v->hdr->nlists) || (n > v->hdr->nlists - first)) {
+		return false;
+	}
+
+	for (i = first; i < first + n; i++) {
+		const char *name;
+
+		if (v->lists[i] >= v->hdr->strings_len) {
+			return false;
+		}
+		name = v->strings + v->lists[i];
+		if (NULL != tty) {
+			if (portcmp (name, tty) == 0) {
+				return true;
+			}
+		} else if (   (strcmp (user, name) == 0)
+		           || (strcmp (name, "*") == 0)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+/*
+ * Find the first entry of the list of k (before best) which also lists
+ * the tty (if tty is not NULL) or the user.
+ */
+static uint32_t port_scan (const struct port_view *v,
+                           /*@null@*/const struct port_key *k, uint32_t best,
+                           /*@null@*/const char *tty, const char *user)
+{
+	uint32_t i;
+
+	if (NULL == k) {
+		return best;
+	}
+	for (i = k->list; i < k->list + k->nlist; i++) {
+		if (v->lists[i] >= best) {
+			break;
+		}
+		if (port_entry_has (v, v->lists[i], tty, user)) {
+			return v->lists[i];
+		}
+	}
+	return best;
+}
+
+/*
+ * Find the times of the entry for user and tty in a compiled ports file.
+ */
+static /*@null@*/const struct pt_time *port_find (const struct port_view *v,
+                                                  const char *user,
+                                                  const char *tty)
+{
+	const struct port_key *tk, *uk, *sk, *k;
+	uint32_t best = v->hdr->nentries;
+	size_t nt, nu;
+	const struct port_entry *pe;
+
+	tk = port_find_key (v, v->tty_buckets, v->hdr->ntty, tty);
+	uk = port_find_key (v, v->user_buckets, v->hdr->nuser, user);
+	sk = (strcmp (user, "*") != 0)
+	   ? port_find_key (v, v->user_buckets, v->hdr->nuser, "*")
+	   : NULL;
+
+	nt = (NULL != tk) ? tk->nlist : 0;
+	for (k = port_key (v, v->hdr->wild); NULL != k; k = port_key (v, k->next)) {
+		if (portcmp (v->strings + k->name, tty) == 0) {
+			nt += k->nlist;
+		}
+	}
+	nu = ((NULL != uk) ? uk->nlist : 0) + ((NULL != sk) ? sk->nlist : 0);
+
+	if (nu <= nt) {
+		best = port_scan (v, uk, best, tty, user);
+		best = port_scan (v, sk, best, tty, user);
+	} else {
+		best = port_scan (v, tk, best, NULL, user);
+		for (k = port_key (v, v->hdr->wild);
+		     NULL != k;
+		     k = port_key (v, k->next)) {
+			if (portcmp (v->strings + k->name, tty) == 0) {
+				best = port_scan (v, k, best, NULL, user);
+			}
+		}
+	}
+
+	if (best >= v->hdr->nentries) {
+		return NULL;
+	}
+	pe = &v->entries[best];
+	if (pe->times >= v->hdr->ntimes) {
+		return NULL;
+	}
+	return &v->times[pe->times];
+}
+
+struct port_build {
+	struct cache_buf keys;		/* struct port_key */
+	struct cache_buf last;		/* uint32_t, last entry + 1 of a key */
+	struct cache_buf pairs;		/* uint32_t key, entry */
+	struct cache_buf names;		/* uint32_t, names of the entries */
+	struct cache_buf strings;
+};
+
+/*
+ * Add entry e to the key name of the chain starting at *head, and store
+ * the offset of name in the strings in *off.
+ *
+ * Return 0 on success, -1 on failure.
+ */
+static int port_build_add (struct port_build *b, uint32_t *head,
+                           const char *name, uint32_t e,
+                           /*@out@*/uint32_t *off)
+{
+	struct port_key *k = NULL;
+	uint32_t i;
+	uint32_t *last;
+
+	for (i = *head; 0 != i; i = k->next) {
+		k = (struct port_key *) b->keys.data + (i - 1);
+		if (strcmp (b->strings.data + k->name, name) == 0) {
+			break;
+		}
+	}
+
+	if (0 == i) {
+		struct port_key nk;
+		uint32_t zero = 0;
+
+		nk.name = (uint32_t) b->strings.len;
+		nk.next = *head;
+		nk.list = 0;
+		nk.nlist = 0;
+		if (   (cache_buf_add (&b->strings, name, strlen (name) + 1) != 0)
+		    || (cache_buf_add (&b->keys, &nk, sizeof nk) != 0)
+		    || (cache_buf_add (&b->last, &zero, sizeof zero) != 0)) {
+			return -1;
+		}
+		i = (uint32_t) (b->keys.len / sizeof nk);
+		*head = i;
+	}
+
+	k = (struct port_key *) b->keys.data + (i - 1);
+	last = (uint32_t *) b->last.data + (i - 1);
+	if (*last != e + 1) {
+		uint32_t pair[2];
+
+		pair[0] = i - 1;
+		pair[1] = e;
+		if (cache_buf_add (&b->pairs, pair, sizeof pair) != 0) {
+			return -1;
+		}
+		*last = e + 1;
+		k->nlist++;
+	}
+	*off = k->name;
+	return 0;
+}
+
+/*
+ * Compile the ports file, opened with setportent().
+ *
+ * Return the compiled file (to be freed by the caller) and store its
+ * length in *len, or return NULL on failure.
+ */
+static /*@null@*/void *port_compile (size_t *len)
+{
+	struct port_build b;
+	struct cache_buf entries = { NULL, 0, 0 };
+	struct cache_buf times = { NULL, 0, 0 };
+	uint32_t *buckets = NULL;
+	uint32_t *lists = NULL;
+	struct port_db hdr;
+	struct port *port;
+	size_t nnames = 0, nusers = 0;
+	uint32_t e;
+	size_t i;
+	char *db = NULL;
+
+	memzero (&b, sizeof b);
+	memzero (&hdr, sizeof hdr);
+
+	/* First, count the names to size the hash tables */
+	while ((port = getportent ()) != NULL) {
+		for (i = 0; NULL != port->pt_names[i]; i++) {
+			nnames++;
+		}
+		for (i = 0; (NULL != port->pt_users) && (NULL != port->pt_users[i]); i++) {
+			nusers++;
+		}
+	}
+	hdr.ntty = 16;
+	while (hdr.ntty < 2 * nnames) {
+		hdr.ntty *= 2;
+	}
+	hdr.nuser = 16;
+	while (hdr.nuser < 2 * nusers) {
+		hdr.nuser *= 2;
+	}
+	buckets = calloc ((size_t) hdr.ntty + hdr.nuser, sizeof *buckets);
+	if (NULL == buckets) {
+		goto fail;
+	}
+
+	/* Then build the tables */
+	setportent ();
+	e = 0;
+	while ((port = getportent ()) != NULL) {
+		struct port_entry pe;
+		uint32_t off;
+
+		if (NULL == port->pt_users) {
+			continue;	/* never matches */
+		}
+
+		pe.names = (uint32_t) (b.names.len / sizeof (uint32_t));
+		for (pe.nnames = 0; NULL != port->pt_names[pe.nnames]; pe.nnames++) {
+			const char *name = port->pt_names[pe.nnames];
+			uint32_t *head;
+
+			head = (strchr (name, '*') != NULL)
+			     ? &hdr.wild
+			     : &buckets[commonio_hash (name) & (hdr.ntty - 1)];
+			if (   (port_build_add (&b, head, name, e, &off) != 0)
+			    || (cache_buf_add (&b.names, &off, sizeof off) != 0)) {
+				goto fail;
+			}
+		}
+		pe.users = (uint32_t) (b.names.len / sizeof (uint32_t));
+		for (pe.nusers = 0; NULL != port->pt_users[pe.nusers]; pe.nusers++) {
+			const char *name = port->pt_users[pe.nusers];
+
+			uint32_t *head;
+
+			head = &buckets[  hdr.ntty
+			                + (commonio_hash (name) & (hdr.nuser - 1))];
+			if (   (port_build_add (&b, head, name, e, &off) != 0)
+			    || (cache_buf_add (&b.names, &off, sizeof off) != 0)) {
+				goto fail;
+			}
+		}
+
+		pe.times = (uint32_t) (times.len / sizeof (struct pt_time));
+		for (i = 0;
+		     (NULL != port->pt_times) && (-1 != port->pt_times[i].t_start);
+		     i++) {
+			if (cache_buf_add (&times, &port->pt_times[i],
+			                  sizeof (struct pt_time)) != 0) {
+				goto fail;
+			}
+		}
+		if (   (cache_buf_add (&times, no_times, sizeof no_times) != 0)
+		    || (cache_buf_add (&entries, &pe, sizeof pe) != 0)) {
+			goto fail;
+		}
+		e++;
+	}
+
+	hdr.nkeys = (uint32_t) (b.keys.len / sizeof (struct port_key));
+	hdr.nentries = e;
+	hdr.ntimes = (uint32_t) (times.len / sizeof (struct pt_time));
+	hdr.strings_len = (uint32_t) b.strings.len;
+
+	/* The lists of the keys follow the names of the entries */
+	hdr.nlists = (uint32_t) (  (b.names.len + b.pairs.len / 2)
+	                         / sizeof (uint32_t));
+	lists = malloc (((size_t) hdr.nlists + 1) * sizeof *lists);
+	if (NULL == lists) {
+		goto fail;
+	}
+	if (0 != b.names.len) {
+		memcpy (lists, b.names.data, b.names.len);
+	}
+	{
+		struct port_key *keys = (struct port_key *) b.keys.data;
+		const uint32_t *pairs = (const uint32_t *) b.pairs.data;
+		uint32_t next = (uint32_t) (b.names.len / sizeof (uint32_t));
+
+		for (i = 0; i < hdr.nkeys; i++) {
+			keys[i].list = next;
+			next += keys[i].nlist;
+			keys[i].nlist = 0;
+		}
+		for (i = 0; i < b.pairs.len / (2 * sizeof (uint32_t)); i++) {
+			struct port_key *k = &keys[pairs[2 * i]];
+
+			lists[k->list + k->nlist] = pairs[2 * i + 1];
+			k->nlist++;
+		}
+	}
+
+	*len = sizeof hdr
+	       + ((size_t) hdr.ntty + hdr.nuser) * sizeof *buckets
+	       + b.keys.len
+	       + (size_t) hdr.nlists * sizeof *lists
+	       + entries.len
+	       + times.len
+	       + b.strings.len;
+	db = malloc (*len);
+	if (NULL != db) {
+		char *p = db;
+
+		memcpy (p, &hdr, sizeof hdr);
+		p += sizeof hdr;
+		memcpy (p, buckets, ((size_t) hdr.ntty + hdr.nuser) * sizeof *buckets);
+		p += ((size_t) hdr.ntty + hdr.nuser) * sizeof *buckets;
+		if (0 != b.keys.len) {
+			memcpy (p, b.keys.data, b.keys.len);
+			p += b.keys.len;
+		}
+		if (0 != hdr.nlists) {
+			memcpy (p, lists, (size_t) hdr.nlists * sizeof *lists);
+			p += (size_t) hdr.nlists * sizeof *lists;
+		}
+		if (0 != entries.len) {
+			memcpy (p, entries.data, entries.len);
+			p += entries.len;
+		}
+		if (0 != times.len) {
+			memcpy (p, times.data, times.len);
+			p += times.len;
+		}
+		if (0 != b.strings.len) {
+			memcpy (p, b.strings.data, b.strings.len);
+		}
+	}
+
+      fail:
+	free (b.keys.data);
+	free (b.last.data);
+	free (b.pairs.data);
+	free (b.names.data);
+	free (b.strings.data);
+	free (entries.data);
+	free (times.data);
+	free (buckets);
+	free (lists);
+	return db;
+}
+
+static void port_unload (void)
+{
+	if (NULL != port_db) {
+		if (port_db_mapped) {
+			cache_unmap (port_db, port_db_len);
+		} else {
+			free ((void *) port_db);
+		}
+	}
+	port_db = NULL;
+	port_db_len = 0;
+	port_db_mapped = false;
+	port_loaded = false;
+}
 
-	pp = getttyuser (port, id);
-	if (NULL == pp) {
+/*
+ * Replace the loaded entries by db (NULL: no restrictions), which was
+ * compiled from the PORTS of sb.
+ */
+static void port_set (/*@null@*/const void *db, size_t len, bool mapped,
+                      const struct port_view *v, const struct stat *sb)
+{
+	port_unload ();
+	port_db = db;
+	port_db_len = len;
+	port_db_mapped = mapped;
+	if (NULL != db) {
+		port_v = *v;
+	}
+	port_stat = *sb;
+	port_loaded = true;
+}
+
+/*
+ * port_reload - load the compiled /etc/porttime
+ *
+ *	The compiled file is taken from the cache if it is up to date, or
+ *	compiled (and cached) again. It is only loaded again if
+ *	/etc/porttime changed since it was last loaded.
+ *
+ *	Return true if the entries were (re)loaded. On failure, the
+ *	entries previously loaded are kept (and their times remain valid),
+ *	and the next call tries again.
+ */
+bool port_reload (void)
+{
+	struct stat sb;
+	struct port_view v;
+	const void *mapped;
+	void *compiled;
+	size_t len = 0;
+
+	if (stat (PORTS, &sb) != 0) {
+		memzero (&sb, sizeof sb);
+	}
+	if (port_loaded && cache_same_file (&sb, &port_stat)) {
+		return false;
+	}
+
+	if (0 != sb.st_ino) {
+		mapped = cache_map (PORT_CACHE, PORT_MAGIC, &sb, &len);
+		if (NULL != mapped) {
+			if (port_view (mapped, len, &v)) {
+				port_set (mapped, len, true, &v, &sb);
+				return true;
+			}
+			cache_unmap (mapped, len);
+		}
+	}
+
+	setportent ();
+	if (NULL == ports) {
+		/* No PORTS, no restrictions */
+		port_set (NULL, 0, false, NULL, &sb);
 		return true;
 	}
+	if (fstat (fileno (ports), &sb) != 0) {
+		endportent ();
+		return false;
+	}
+	compiled = port_compile (&len);
+	endportent ();
+	if (NULL == compiled) {
+		return false;
+	}
+	if (!port_view (compiled, len, &v)) {
+		free (compiled);
+		return false;
+	}
+	(void) cache_write (PORT_CACHE, PORT_MAGIC, &sb, compiled, len);
+	port_set (compiled, len, false, &v, &sb);
+	return true;
+}
+
+/*
+ * port_rule - get the times of the entry of /etc/porttime for user and
+ *             tty
+ *
+ *	The entries are searched like getttyuser() does, in the entries
+ *	loaded by port_reload(). The times remain valid until the entries
+ *	are reloaded. An entry without times has an empty list of times.
+ *
+ *	Return NULL if no entry matches, or if no entries are loaded.
+ */
+/*@null@*/ /*@observer@*/const struct pt_time *port_rule (const char *user,
+                                                         const char *tty)
+{
+	if (NULL == port_db) {
+		return NULL;
+	}
+	return port_find (&port_v, user, tty);
+}
+
+/*
+ * port_allows - tell if the times of an entry of /etc/porttime allow a
+ *               login at a particular time
+ */
+bool port_allows (const struct pt_time *times, time_t when)
+{
+	int i;
+	int dtime;
+	struct tm *tm;
 
 	/*
 	 * The entry is there, but has no time entries - don't
 	 * ever let them login.
 	 */
 
-	if (0 == pp->pt_times) {
+	if (-1 == times[0].t_start) {
 		return false;
 	}
 
@@ -449,19 +1063,19 @@ bool isttytime (const char *id, const char *port, time_t when)
 	 * midnight and either the start or end time.
 	 */
 
-	for (i = 0; pp->pt_times[i].t_start != -1; i++) {
-		if (!(pp->pt_times[i].t_days & PORT_DAY (tm->tm_wday))) {
+	for (i = 0; times[i].t_start != -1; i++) {
+		if (!(times[i].t_days & PORT_DAY (tm->tm_wday))) {
 			continue;
 		}
 
-		if (pp->pt_times[i].t_start <= pp->pt_times[i].t_end) {
-			if (   (dtime >= pp->pt_times[i].t_start)
-			    && (dtime <= pp->pt_times[i].t_end)) {
+		if (times[i].t_start <= times[i].t_end) {
+			if (   (dtime >= times[i].t_start)
+			    && (dtime <= times[i].t_end)) {
 				return true;
 			}
 		} else {
-			if (   (dtime >= pp->pt_times[i].t_start)
-			    || (dtime <= pp->pt_times[i].t_end)) {
+			if (   (dtime >= times[i].t_start)
+			    || (dtime <= times[i].t_end)) {
 				return true;
 			}
 		}
@@ -475,3 +1089,105 @@ bool isttytime (const char *id, const char *port, time_t when)
 	return false;
 }
 
+/*
+ * port_next_change - get the next time the result of port_allows() may
+ *                    change for the times of an entry of /etc/porttime
+ *
+ *	The result only changes at midnight, at the start of a time range,
+ *	or one minute after its end. The next full hour is returned if it
+ *	comes first, so that a boundary skipped by a change of daylight
+ *	saving time is not missed.
+ *
+ *	Return (time_t) -1 if the result never changes.
+ */
+time_t port_next_change (const struct pt_time *times, time_t when)
+{
+	struct tm tm;
+	time_t next;
+	int now;
+	int i;
+
+	if (-1 == times[0].t_start) {
+		return (time_t) -1;
+	}
+	next = (when / 3600 + 1) * 3600;
+	if (NULL == localtime_r (&when, &tm)) {
+		return next;
+	}
+	now = tm.tm_hour * 60 + tm.tm_min;
+
+	/* i == -1 is midnight */
+	for (i = -1; (i < 0) || (times[i].t_start != -1); i++) {
+		int b[2];
+		int k;
+
+		if (i < 0) {
+			b[0] = b[1] = 0;
+		} else {
+			b[0] =   (times[i].t_start / 100) * 60
+			       + times[i].t_start % 100;
+			b[1] =   (times[i].t_end / 100) * 60
+			       + times[i].t_end % 100 + 1;
+		}
+		/*
+		 * Each boundary is converted with the current daylight
+		 * saving time, and with the one in effect at the boundary,
+		 * so that it is found when the local time is repeated.
+		 */
+		for (k = 0; k < 4; k++) {
+			struct tm t = tm;
+			time_t cand;
+			int m = b[k / 2] % (24 * 60);
+
+			t.tm_hour = m / 60;
+			t.tm_min = m % 60;
+			t.tm_sec = 0;
+			if (m <= now) {
+				t.tm_mday++;
+			}
+			t.tm_isdst = ((k % 2) == 0) ? -1 : tm.tm_isdst;
+			cand = mktime (&t);
+			if (   ((time_t) -1 != cand)
+			    && (cand > when)
+			    && (cand < next)) {
+				next = cand;
+			}
+		}
+	}
+
+	return next;
+}
+
+/*
+ * isttytime - tell if a given user may login at a particular time
+ *
+ *	isttytime searches the ports file for an entry which matches
+ *	the user name and TTY given.
+ */
+
+bool isttytime (const char *id, const char *port, time_t when)
+{
+	const struct pt_time *times;
+
+	/*
+	 * Try to find a matching entry for this user.  Default to
+	 * letting the user in - there are plenty of ways to have an
+	 * entry to match all users.
+	 */
+
+	(void) port_reload ();
+	if (port_loaded) {
+		times = port_rule (id, port);
+	} else {
+		const struct port *pp = getttyuser (port, id);
+
+		times = (NULL == pp) ? NULL
+		      : (NULL != pp->pt_times) ? pp->pt_times
+		      : no_times;
+	}
+	if (NULL == times) {
+		return true;
+	}
+
+	return port_allows (times, when);
+}
@@ -85,6 +85,27 @@ extern int is_btrfs(const char *path);
 /* basename.c */
 extern /*@observer@*/const char *Basename (const char *str);
 
+/* cacheflush.c */
+extern bool cache_flush_defer_nscd (const char *service);
+extern bool cache_flush_defer_sssd (int dbflags);
+
+/* cachefile.c */
+struct cache_buf {
+	char *data;
+	size_t len;
+	size_t size;
+};
+extern int cache_buf_add (struct cache_buf *buf, const void *data, size_t len);
+extern int cache_buf_add_key (struct cache_buf *buf,
+                              /*@null@*/const struct stat *src);
+extern /*@null@*/const void *cache_map (const char *name, const char *magic,
+                                        const struct stat *src, size_t *len);
+extern void cache_unmap (const void *data, size_t len);
+extern int cache_mkdir (void);
+extern bool cache_same_file (const struct stat *sb1, const struct stat *sb2);
+extern int cache_write (const char *name, const char *magic,
+                        const struct stat *src, const void *data, size_t len);
+
 /* chowndir.c */
 extern int chown_tree (const char *root,
                        uid_t old_uid, uid_t new_uid,
@@ -176,6 +197,8 @@ extern int get_gid (const char *gidstr, gid_t *gid);
 extern /*@only@*//*@null@*/struct group *getgr_nam_gid (/*@null@*/const char *grname);
 
 /* getlong.c */
+extern int getdec (const char *numstr, bool base0,
+                   /*@out@*/unsigned long long *result);
 extern int getlong (const char *numstr, /*@out@*/long int *result);
 
 /* get_pid.c */
@@ -199,6 +222,10 @@ extern int getulong (const char *numstr, /*@out@*/unsigned long int *result);
 extern /*@null@*/char *fgetsx (/*@returned@*/ /*@out@*/char *, int, FILE *);
 extern int fputsx (const char *, FILE *);
 
+/* grouplist.c */
+extern /*@null@*/ /*@only@*/gid_t *get_grouplist (const char *user, gid_t group,
+                                                 int *ngroups);
+
 /* groupio.c */
 extern void __gr_del_entry (const struct commonio_entry *ent);
 extern /*@observer@*/const struct commonio_db *__gr_get_db (void);
@@ -210,9 +237,28 @@ extern /*@null@*/ /*@only@*/struct group *__gr_dup (const struct group *grent);
 extern void gr_free_members (struct group *grent);
 extern void gr_free (/*@out@*/ /*@only@*/struct group *grent);
 extern bool gr_append_member (struct group *grp, char *member);
+struct memberset;
+extern /*@null@*/ /*@only@*/struct memberset *memberset_new (/*@null@*/char *const *list);
+extern void memberset_free (/*@only@*/struct memberset *set);
+extern bool memberset_contains (const struct memberset *set, const char *member);
+extern size_t memberset_count (const struct memberset *set);
+extern int memberset_add (struct memberset *set, const char *member);
+extern bool memberset_del (struct memberset *set, const char *member);
+extern /*@null@*/ /*@only@*/char **memberset_list (const struct memberset *set);
+extern bool gr_set_members (struct group *grp, const struct memberset *set);
 
 /* hushed.c */
-extern bool hushed (const char *username);
+extern bool hushed (const char *username,
+                    /*@null@*/const struct passwd *pw);
+
+/* instr.c */
+struct instr_mark {
+	/*@null@*/struct instr_phase *phase;
+	struct timespec start;
+};
+extern void instr_begin (/*@out@*/struct instr_mark *mark, const char *name);
+extern void instr_end (const struct instr_mark *mark);
+extern void instr_count (const char *name, unsigned long n);
 
 /* audit_help.c */
 #ifdef WITH_AUDIT
@@ -248,6 +294,12 @@ extern void dolastlog (
 	/*@unique@*/const char *line,
 	/*@unique@*/const char *host);
 
+/* log_reset.c */
+extern void faillog_reset (uid_t uid);
+extern void lastlog_reset (uid_t uid);
+extern void tallylog_reset (uid_t uid, const char *user_name);
+extern void log_reset_close (void);
+
 /* login_nopam.c */
 extern int login_access (const char *user, const char *from);
 
@@ -263,6 +315,20 @@ extern void motd (void);
 /* myname.c */
 extern /*@null@*//*@only@*/struct passwd *get_my_pwent (void);
 
+/* nametable.c */
+struct nametable;
+typedef bool (*nametable_parse) (char *line,
+                                 /*@out@*/const char **name,
+                                 const char **value);
+extern /*@null@*/ /*@only@*/struct nametable *nametable_load (
+	FILE *fp,
+	const char *cache,
+	nametable_parse parse);
+extern /*@null@*/ /*@observer@*/const char *nametable_find (
+	const struct nametable *table,
+	const char *name);
+extern void nametable_free (/*@only@*/struct nametable *table);
+
 /* nss.c */
 #include <libsubid/subid.h>
 extern void nss_init(char *nsswitch_path);
@@ -312,6 +378,58 @@ struct subid_nss_ops {
 	 */
 	enum subid_status (*find_subid_owners)(unsigned long id, enum subid_type id_type, uid_t **uids, int *count);
 
+	/*
+	 * The following batch queries are optional. When a module does not
+	 * provide them, the batch queries of libsubid fall back to one call
+	 * of the functions above per item.
+	 */
+
+	/*
+	 * nss_list_owners_ranges: list the subid ranges delegated to several
+	 * users.
+	 *
+	 * @owners - array of @n usernames being queried
+	 * @id_type - subuid or subgid
+	 * @ranges - pointer to an array of struct subordinate_range, or NULL.
+	 *           The ranges are in the order of @owners, and their ->owner
+	 *           points to the string of @owners. The returned array must
+	 *           be freed by the caller.
+	 * @count - pointer to an integer into which the number of returned ranges
+	 *          is written.
+	 *
+	 * returns success if the module was able to determine an answer,
+	 * else an error status.
+	 */
+	enum subid_status (*list_owners_ranges)(const char *const *owners, size_t n, enum subid_type id_type, struct subordinate_range **ranges, int *count);
+
+	/*
+	 * nss_find_ids_owners: find the uids who own several subuids or subgids.
+	 *
+	 * @ids - array of @n delegated ids being queried
+	 * @id_type - subuid or subgid
+	 * @owners - pointer to an array of (id, uid) pairs, in the order of
+	 *           @ids, which will be allocated by nss_find_ids_owners()
+	 * @count - number of pairs found
+	 *
+	 * returns success if the module was able to determine an answer,
+	 * else an error status.
+	 */
+	enum subid_status (*find_ids_owners)(const unsigned long *ids, size_t n, enum subid_type id_type, struct subid_owner **owners, int *count);
+
+	/*
+	 * nss_list_all_ranges: list all the subid ranges.
+	 *
+	 * @id_type - subuid or subgid
+	 * @ranges - pointer to an array of struct subordinate_range, or NULL.
+	 *           The returned array and each ->owner must be freed by the
+	 *           caller.
+	 * @count - number of ranges found
+	 *
+	 * returns success if the module was able to determine an answer,
+	 * else an error status.
+	 */
+	enum subid_status (*list_all_ranges)(enum subid_type id_type, struct subordinate_range **ranges, int *count);
+
 	/* The dlsym handle to close */
 	void *handle;
 };
@@ -324,6 +442,10 @@ extern struct subid_nss_ops *get_subid_nss_handle();
 extern int do_pam_passwd_non_interactive (const char *pam_service,
                                            const char *username,
                                            const char* password);
+extern int do_pam_passwd_non_interactive_batch (const char *pam_service,
+                                                 const char *username,
+                                                 const char* password);
+extern void end_pam_passwd_non_interactive (void);
 #endif				/* USE_PAM */
 
 /* obscure.c */
@@ -337,7 +459,14 @@ extern void do_pam_passwd (const char *user, bool silent, bool change_expired);
 #endif
 
 /* port.c */
+struct pt_time;
 extern bool isttytime (const char *, const char *, time_t);
+extern bool port_reload (void);
+extern /*@null@*/ /*@observer@*/const struct pt_time *port_rule (
+	const char *user,
+	const char *tty);
+extern bool port_allows (const struct pt_time *times, time_t when);
+extern time_t port_next_change (const struct pt_time *times, time_t when);
 
 /* prefix_flag.c */
 extern const char* process_prefix_flag (const char* short_opt, int argc, char **argv);
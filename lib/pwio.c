@@ -95,7 +95,8 @@ static struct commonio_ops passwd_ops = {
 	fgets,
 	fputs,
 	NULL,			/* open_hook */
-	NULL			/* close_hook */
+	NULL,			/* close_hook */
+	NULL			/* members */
 };
 
 static struct commonio_db passwd_db = {
@@ -115,7 +116,8 @@ static struct commonio_db passwd_db = {
 	false,			/* isopen */
 	false,			/* locked */
 	false,			/* readonly */
-	false			/* setname */
+	false,			/* setname */
+	NULL			/* member_index */
 };
 
 int pw_setdbname (const char *filename)
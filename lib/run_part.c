@@ -8,18 +8,20 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <lib/prototypes.h>
+#include "getdef.h"
 
-int run_part (char *script_path, char *name, char *action)
+/*
+ * Start a script. Return its PID, or -1 on failure.
+ */
+static pid_t run_part_start (char *script_path, char *name, char *action)
 {
-	int pid;
-	int wait_status;
-	int pid_status;
+	pid_t pid;
 	char *args[] = { script_path, NULL };
 
 	pid=fork();
 	if (pid==-1) {
 		perror ("Could not fork");
-		return 1;
+		return -1;
 	}
 	if (pid==0) {
 		setenv ("ACTION",action,1);
@@ -28,75 +30,205 @@ int run_part (char *script_path, char *name, char *action)
 		perror ("execv");
 		exit(1);
 	}
+	return pid;
+}
 
-	pid_status = wait (&wait_status);
-	if (pid_status == pid) {
-		return (wait_status);
+/*
+ * Wait for a script started by run_part_start. Return its wait status.
+ */
+static int run_part_wait (pid_t pid)
+{
+	int wait_status;
+
+	while (waitpid (pid, &wait_status, 0) != pid) {
+		if (errno != EINTR) {
+			perror ("waitpid");
+			return (1);
+		}
 	}
+	return (wait_status);
+}
+
+int run_part (char *script_path, char *name, char *action)
+{
+	pid_t pid;
 
-	perror ("waitpid");
-	return (1);
+	pid = run_part_start (script_path, name, action);
+	if (pid == -1) {
+		return 1;
+	}
+	return run_part_wait (pid);
 }
 
-int run_parts (char *directory, char *name, char *action)
+/*
+ * Tell if two scripts have the same numeric prefix, and may therefore
+ * run at the same time.
+ */
+static bool run_parts_together (const char *a, const char *b)
 {
-	struct dirent **namelist;
-	int scanlist;
-	int n;
-	int execute_result;
+	size_t len = strspn (a, "0123456789");
 
-	scanlist = scandir (directory, &namelist, 0, alphasort);
-	if (scanlist<0) {
-		return (0);
+	return    (len != 0)
+	       && (strspn (b, "0123456789") == len)
+	       && (strncmp (a, b, len) == 0);
+}
+
+/*
+ * Run a group of scripts, at most jobs of them at the same time.
+ *
+ * No script is started after a failure; the running ones are waited
+ * for. Return the status of the first failure, or 0.
+ */
+static int run_parts_group (char *directory, struct dirent **entries,
+                            int count, char *name, char *action,
+                            unsigned int jobs)
+{
+	pid_t *pids;
+	unsigned int running = 0;
+	int result = 0;
+	int started;		/* scripts started (or skipped) */
+	int waited = 0;		/* scripts waited for */
+
+	pids = (pid_t *) malloc (count * sizeof (pids[0]));
+	if (!pids) {
+		printf ("could not allocate memory\n");
+		return (1);
 	}
 
-	for (n=0; n<scanlist; n++) {
+	for (started = 0; (started < count) && (result == 0); started++) {
 		int path_length;
 		struct stat sb;
+		char *s;
+
+		/* Respect the concurrency limit: wait for the oldest script */
+		while (running >= jobs) {
+			int status = 0;
+
+			if (pids[waited] > 0) {
+				status = run_part_wait (pids[waited]);
+				running--;
+			} else if (pids[waited] == -1) {
+				status = 1;
+			}
+			if (status != 0) {
+				fprintf (shadow_logfd,
+					"%s: did not exit cleanly.\n",
+				    entries[waited]->d_name);
+				if (result == 0) {
+					result = status;
+				}
+			}
+			waited++;
+		}
+		if (result != 0) {
+			break;
+		}
 
-		path_length=strlen(directory) + strlen(namelist[n]->d_name) + 2;
-		char *s = (char*)malloc(path_length);
+		path_length=strlen(directory) + strlen(entries[started]->d_name) + 2;
+		s = (char*)malloc(path_length);
 		if (!s) {
 			printf ("could not allocate memory\n");
-			for (; n<scanlist; n++) {
-				free (namelist[n]);
-			}
-			free (namelist);
-			return (1);
+			result = 1;
+			break;
 		}
-		snprintf (s, path_length, "%s/%s", directory, namelist[n]->d_name);
+		snprintf (s, path_length, "%s/%s", directory, entries[started]->d_name);
 
-		execute_result = 0;
+		/* The type given by the directory saves a stat */
+		pids[started] = 0;
+#ifdef _DIRENT_HAVE_D_TYPE
+		if (entries[started]->d_type == DT_REG) {
+			sb.st_mode = S_IFREG;
+		} else if (   (entries[started]->d_type != DT_UNKNOWN)
+		           && (entries[started]->d_type != DT_LNK)) {
+			sb.st_mode = 0;
+		} else
+#endif
 		if (stat (s, &sb) == -1) {
 			perror ("stat");
 			free (s);
-			for (; n<scanlist; n++) {
-				free (namelist[n]);
-			}
-			free (namelist);
-			return (1);
+			result = 1;
+			break;
 		}
 
 		if (S_ISREG (sb.st_mode) || S_ISLNK (sb.st_mode)) {
-			execute_result = run_part (s, name, action);
+			pids[started] = run_part_start (s, name, action);
+			if (pids[started] > 0) {
+				running++;
+			} else {
+				/* fork failed: start nothing more */
+				result = 1;
+			}
 		}
 
 		free (s);
+	}
 
-		if (execute_result!=0) {
+	/* Collect the scripts still running */
+	for (; waited < started; waited++) {
+		int status = 0;
+
+		if (pids[waited] > 0) {
+			status = run_part_wait (pids[waited]);
+		} else if (pids[waited] == -1) {
+			status = 1;
+		}
+		if (status != 0) {
 			fprintf (shadow_logfd,
 				"%s: did not exit cleanly.\n",
-			    namelist[n]->d_name);
-			for (; n<scanlist; n++) {
-				free (namelist[n]);
+			    entries[waited]->d_name);
+			if (result == 0) {
+				result = status;
+			}
+		}
+	}
+
+	free (pids);
+	return (result);
+}
+
+/*
+ * run_parts - run the scripts of a directory
+ *
+ *	The scripts are run in the order of their names, and the first
+ *	failure stops the execution.
+ *
+ *	If RUN_PARTS_JOBS is set in login.defs, consecutive scripts
+ *	whose names start with the same number (e.g. 50-quota and
+ *	50-ldap) run at the same time, at most RUN_PARTS_JOBS at once.
+ */
+int run_parts (char *directory, char *name, char *action)
+{
+	struct dirent **namelist;
+	int scanlist;
+	int n, m;
+	int execute_result = 0;
+	unsigned int jobs;
+
+	scanlist = scandir (directory, &namelist, 0, alphasort);
+	if (scanlist<0) {
+		return (0);
+	}
+
+	jobs = getdef_unum ("RUN_PARTS_JOBS", 1);
+	if (jobs < 1) {
+		jobs = 1;
+	}
+
+	for (n=0; (n<scanlist) && (execute_result==0); n=m) {
+		for (m=n+1; (m<scanlist) && (jobs>1); m++) {
+			if (!run_parts_together (namelist[n]->d_name,
+			                         namelist[m]->d_name)) {
+				break;
 			}
-			break;
 		}
+		execute_result = run_parts_group (directory, namelist+n, m-n,
+		                                  name, action, jobs);
+	}
 
+	for (n=0; n<scanlist; n++) {
 		free (namelist[n]);
 	}
 	free (namelist);
 
 	return (execute_result);
 }
-
@@ -108,20 +108,21 @@ struct group *sgetgrent (const char *buf)
 	static struct group grent;
 	int i;
 	char *cp;
+	size_t len = strlen (buf);
 
-	if (strlen (buf) + 1 > size) {
+	if (len + 1 > size) {
 		/* no need to use realloc() here - just free it and
 		   allocate a larger block */
 		if (grpbuf)
 			free (grpbuf);
-		size = strlen (buf) + 1000;	/* at least: strlen(buf) + 1 */
+		size = len + 1000;	/* at least: strlen(buf) + 1 */
 		grpbuf = malloc (size);
 		if (!grpbuf) {
 			size = 0;
 			return 0;
 		}
 	}
-	strcpy (grpbuf, buf);
+	memcpy (grpbuf, buf, len + 1);
 
 	cp = strrchr (grpbuf, '\n');
 	if (NULL != cp) {
@@ -58,35 +58,34 @@ struct passwd *sgetpwent (const char *buf)
 {
 	static struct passwd pwent;
 	static char pwdbuf[1024];
-	register int i;
-	register char *cp;
+	int i;
+	char *cp;
 	char *fields[NFIELDS];
+	size_t len;
 
 	/*
 	 * Copy the string to a static buffer so the pointers into
 	 * the password structure remain valid.
 	 */
 
-	if (strlen (buf) >= sizeof pwdbuf)
+	len = strlen (buf);
+	if (len >= sizeof pwdbuf)
 		return 0;	/* fail if too long */
-	strcpy (pwdbuf, buf);
+	memcpy (pwdbuf, buf, len + 1);
 
 	/*
 	 * Save a pointer to the start of each colon separated
 	 * field.  The fields are converted into NUL terminated strings.
+	 * strchr() is used to find the separators, since the C library
+	 * scans strings several bytes at a time.
 	 */
 
 	for (cp = pwdbuf, i = 0; (i < NFIELDS) && (NULL != cp); i++) {
 		fields[i] = cp;
-		while (('\0' != *cp) && (':' != *cp)) {
-			cp++;
-		}
-
-		if ('\0' != *cp) {
+		cp = strchr (cp, ':');
+		if (NULL != cp) {
 			*cp = '\0';
 			cp++;
-		} else {
-			cp = NULL;
 		}
 	}
 
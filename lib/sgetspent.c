@@ -53,16 +53,18 @@ struct spwd *sgetspent (const char *string)
 	char *fields[FIELDS];
 	char *cp;
 	int i;
+	size_t len;
 
 	/*
 	 * Copy string to local buffer.  It has to be tokenized and we
 	 * have to do that to our private copy.
 	 */
 
-	if (strlen (string) >= sizeof spwbuf) {
+	len = strlen (string);
+	if (len >= sizeof spwbuf) {
 		return 0;	/* fail if too long */
 	}
-	strcpy (spwbuf, string);
+	memcpy (spwbuf, string, len + 1);
 
 	cp = strrchr (spwbuf, '\n');
 	if (NULL != cp) {
@@ -76,9 +78,7 @@ struct spwd *sgetspent (const char *string)
 
 	for (cp = spwbuf, i = 0; ('\0' != *cp) && (i < FIELDS); i++) {
 		fields[i] = cp;
-		while (('\0' != *cp) && (':' != *cp)) {
-			cp++;
-		}
+		cp += strcspn (cp, ":");
 
 		if ('\0' != *cp) {
 			*cp = '\0';
@@ -210,6 +210,21 @@ static int gshadow_put (const void *ent, FILE * file)
 	return (putsgent (sg, file) == -1) ? -1 : 0;
 }
 
+static /*@null@*/char *const *gshadow_members (const void *ent,
+                                               unsigned int n)
+{
+	const struct sgrp *sg = ent;
+
+	switch (n) {
+	case 0:
+		return sg->sg_mem;
+	case 1:
+		return sg->sg_adm;
+	default:
+		return NULL;
+	}
+}
+
 static struct commonio_ops gshadow_ops = {
 	gshadow_dup,
 	gshadow_free,
@@ -219,7 +234,8 @@ static struct commonio_ops gshadow_ops = {
 	fgetsx,
 	fputsx,
 	NULL,			/* open_hook */
-	NULL			/* close_hook */
+	NULL,			/* close_hook */
+	gshadow_members
 };
 
 static struct commonio_db gshadow_db = {
@@ -239,7 +255,8 @@ static struct commonio_db gshadow_db = {
 	false,			/* isopen */
 	false,			/* locked */
 	false,			/* readonly */
-	false			/* setname */
+	false,			/* setname */
+	NULL			/* member_index */
 };
 
 int sgr_setdbname (const char *filename)
@@ -279,6 +296,29 @@ int sgr_update (const struct sgrp *sg)
 	return commonio_update (&gshadow_db, (const void *) sg);
 }
 
+/*
+ * sgr_index_members - build a reverse index from members and
+ * administrators to shadow groups.
+ *
+ * It speeds up sgr_member_of() until the database is closed.
+ */
+int sgr_index_members (void)
+{
+	return commonio_index_members (&gshadow_db);
+}
+
+/*
+ * sgr_member_of - return the shadow groups listing a user as a member
+ * or as an administrator.
+ *
+ * The returned array is NULL terminated, and must be freed by the
+ * caller. The groups must not be used after they are updated.
+ */
+/*@null@*/ /*@only@*/const struct sgrp **sgr_member_of (const char *name)
+{
+	return (const struct sgrp **) commonio_member_of (&gshadow_db, name);
+}
+
 int sgr_remove (const char *name)
 {
 	return commonio_remove (&gshadow_db, name);
@@ -40,6 +40,10 @@ int sssd_flush_cache (int dbflags)
 		free(sss_cache_args);
 		return 0;
 	}
+	if (cache_flush_defer_sssd (dbflags)) {
+		free(sss_cache_args);
+		return 0;
+	}
 	spawnedArgs[1] = sss_cache_args;
 
 	rv = run_command (cmd, spawnedArgs, spawnedEnv, &status);
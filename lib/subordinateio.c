@@ -16,6 +16,11 @@
 #include <pwd.h>
 #include <ctype.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool subordinate_parse_r (char *line, struct subordinate_range *range);
 
 /*
  * subordinate_dup: create a duplicate range
@@ -71,9 +76,6 @@ static void *subordinate_parse (const char *line)
 {
 	static struct subordinate_range range;
 	static char rangebuf[1024];
-	int i;
-	char *cp;
-	char *fields[SUBID_NFIELDS];
 
 	/*
 	 * Copy the string to a temporary buffer so the substrings can
@@ -83,12 +85,33 @@ static void *subordinate_parse (const char *line)
 		return NULL;	/* fail if too long */
 	strcpy (rangebuf, line);
 
+	if (!subordinate_parse_r (rangebuf, &range))
+		return NULL;
+
+	return &range;
+}
+
+/*
+ * subordinate_parse_r: parse a line in place
+ *
+ * @line: a line to parse. The fields are NUL terminated in place.
+ * @range: the subordinate_range struct to fill. Its owner points into
+ *         @line.
+ *
+ * Returns true on success, false if the line is invalid.
+ */
+static bool subordinate_parse_r (char *line, struct subordinate_range *range)
+{
+	int i;
+	char *cp;
+	char *fields[SUBID_NFIELDS];
+
 	/*
 	 * Save a pointer to the start of each colon separated
 	 * field.  The fields are converted into NUL terminated strings.
 	 */
 
-	for (cp = rangebuf, i = 0; (i < SUBID_NFIELDS) && (NULL != cp); i++) {
+	for (cp = line, i = 0; (i < SUBID_NFIELDS) && (NULL != cp); i++) {
 		fields[i] = cp;
 		while (('\0' != *cp) && (':' != *cp)) {
 			cp++;
@@ -107,14 +130,14 @@ static void *subordinate_parse (const char *line)
 	 * the entry is invalid.  Also, fields must be non-blank.
 	 */
 	if (i != SUBID_NFIELDS || *fields[0] == '\0' || *fields[1] == '\0' || *fields[2] == '\0')
-		return NULL;
-	range.owner = fields[0];
-	if (getulong (fields[1], &range.start) == 0)
-		return NULL;
-	if (getulong (fields[2], &range.count) == 0)
-		return NULL;
+		return false;
+	range->owner = fields[0];
+	if (getulong (fields[1], &range->start) == 0)
+		return false;
+	if (getulong (fields[2], &range->count) == 0)
+		return false;
 
-	return &range;
+	return true;
 }
 
 /*
@@ -145,6 +168,7 @@ static struct commonio_ops subordinate_ops = {
 	fputs,			/* fputs */
 	NULL,			/* open_hook */
 	NULL,			/* close_hook */
+	NULL,			/* members */
 };
 
 /*
@@ -309,6 +333,293 @@ static bool have_range(struct commonio_db *db,
 	return false;
 }
 
+/*
+ * Index of the ranges of a subordinate database, to check many IDs
+ * against the ranges of an owner without rescanning the database.
+ *
+ * The ranges are sorted by start. Whether a range belongs to the owner
+ * is resolved (as in find_range) on the first lookup which falls in the
+ * range, and then remembered.
+ */
+struct subid_index_entry {
+	unsigned long start;
+	unsigned long last;
+	unsigned long max_last;	/* highest last of the entries up to this one */
+	/*@null@*/char *owner;
+	int match;		/* -1: unknown, 0: not owned, 1: owned */
+};
+
+struct subid_index {
+	char *owner;
+	bool by_uid;		/* also match the ranges by UID */
+	int owner_uid_known;	/* -1: unknown, 0: no such user, 1: known */
+	uid_t owner_uid;
+	size_t n;
+	struct subid_index_entry *entries;
+};
+
+static int subid_index_cmp (const void *p1, const void *p2)
+{
+	const struct subid_index_entry *e1 = p1;
+	const struct subid_index_entry *e2 = p2;
+
+	if (e1->start < e2->start) {
+		return -1;
+	}
+	return (e1->start > e2->start) ? 1 : 0;
+}
+
+static bool subid_index_add (struct subid_index *idx, size_t *alloc,
+                             unsigned long start, unsigned long count,
+                             /*@null@*/const char *owner, int match)
+{
+	struct subid_index_entry *e;
+
+	if (0 == count) {
+		return true;
+	}
+	if (idx->n == *alloc) {
+		size_t n = (0 == *alloc) ? 16 : *alloc * 2;
+
+		e = realloc (idx->entries, n * sizeof *e);
+		if (NULL == e) {
+			return false;
+		}
+		idx->entries = e;
+		*alloc = n;
+	}
+	e = &idx->entries[idx->n];
+	e->start = start;
+	e->last = start + count - 1;
+	e->owner = NULL;
+	e->match = match;
+	if (NULL != owner) {
+		e->owner = strdup (owner);
+		if (NULL == e->owner) {
+			return false;
+		}
+	}
+	idx->n++;
+	return true;
+}
+
+static /*@null@*/ /*@only@*/struct subid_index *subid_index_new (
+	struct commonio_db *db,
+	const char *owner,
+	enum subid_type id_type)
+{
+	struct subid_index *idx;
+	const struct subordinate_range *range;
+	struct subid_nss_ops *h;
+	size_t alloc = 0;
+	size_t i;
+
+	idx = calloc (1, sizeof *idx);
+	if (NULL == idx) {
+		return NULL;
+	}
+	idx->owner = strdup (owner);
+	if (NULL == idx->owner) {
+		free (idx);
+		return NULL;
+	}
+	idx->owner_uid_known = -1;
+
+	h = get_subid_nss_handle ();
+	if (NULL != h) {
+		struct subid_range *ranges = NULL;
+		int count = 0;
+		int j;
+
+		if (h->list_owner_ranges (owner, id_type, &ranges, &count)
+		    != SUBID_STATUS_SUCCESS) {
+			subid_index_free (idx);
+			return NULL;
+		}
+		for (j = 0; j < count; j++) {
+			if (!subid_index_add (idx, &alloc, ranges[j].start,
+			                      ranges[j].count, NULL, 1)) {
+				free (ranges);
+				subid_index_free (idx);
+				return NULL;
+			}
+		}
+		free (ranges);
+	} else {
+		/* Only these two files match the owners by UID */
+		idx->by_uid = (   (strcmp (db->filename, "/etc/subuid") == 0)
+		               || (strcmp (db->filename, "/etc/subgid") == 0));
+
+		commonio_rewind (db);
+		while ((range = commonio_next (db)) != NULL) {
+			bool added;
+
+			if (strcmp (range->owner, owner) == 0) {
+				added = subid_index_add (idx, &alloc,
+				                         range->start,
+				                         range->count, NULL, 1);
+			} else if (idx->by_uid) {
+				added = subid_index_add (idx, &alloc,
+				                         range->start,
+				                         range->count,
+				                         range->owner, -1);
+			} else {
+				continue;
+			}
+			if (!added) {
+				subid_index_free (idx);
+				return NULL;
+			}
+		}
+	}
+
+	if (0 != idx->n) {
+		qsort (idx->entries, idx->n, sizeof *idx->entries,
+		       subid_index_cmp);
+		idx->entries[0].max_last = idx->entries[0].last;
+		for (i = 1; i < idx->n; i++) {
+			idx->entries[i].max_last = idx->entries[i - 1].max_last;
+			if (idx->entries[i].last > idx->entries[i].max_last) {
+				idx->entries[i].max_last = idx->entries[i].last;
+			}
+		}
+	}
+
+	return idx;
+}
+
+/*
+ * subid_index_owned: resolve whether a range belongs to the owner of the
+ *                    index, with the rules of find_range.
+ */
+static bool subid_index_owned (struct subid_index *idx,
+                               struct subid_index_entry *e)
+{
+	char owner_uid_string[33];
+	const struct passwd *pwd;
+
+	if (-1 != e->match) {
+		return (1 == e->match);
+	}
+
+	e->match = 0;
+	if (-1 == idx->owner_uid_known) {
+		pwd = getpwnam (idx->owner);
+		idx->owner_uid_known = (NULL != pwd) ? 1 : 0;
+		if (NULL != pwd) {
+			idx->owner_uid = pwd->pw_uid;
+		}
+	}
+	if (1 == idx->owner_uid_known) {
+		sprintf (owner_uid_string, "%lu",
+		         (unsigned long int) idx->owner_uid);
+		if (strcmp (e->owner, owner_uid_string) == 0) {
+			e->match = 1;
+		} else {
+			pwd = getpwnam (e->owner);
+			if ((NULL != pwd) && (pwd->pw_uid == idx->owner_uid)) {
+				e->match = 1;
+			}
+		}
+	}
+	return (1 == e->match);
+}
+
+/*
+ * subid_index_find: check whether @id is in one of the ranges of the owner
+ *                   of the index.
+ *
+ * If @last is not NULL, it is set to the highest last ID of these ranges.
+ */
+static bool subid_index_find (struct subid_index *idx, unsigned long id,
+                              /*@null@*/unsigned long *last)
+{
+	size_t lo = 0, hi = idx->n;
+	bool found = false;
+
+	/* Find the first entry starting after id */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (idx->entries[mid].start <= id) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	/* Then check the entries which may still contain id */
+	while (lo > 0) {
+		struct subid_index_entry *e = &idx->entries[lo - 1];
+
+		if (   (e->max_last < id)
+		    || (found && (e->max_last <= *last))) {
+			break;
+		}
+		if (   (e->last >= id)
+		    && (!found || (e->last > *last))
+		    && subid_index_owned (idx, e)) {
+			if (NULL == last) {
+				return true;
+			}
+			found = true;
+			*last = e->last;
+		}
+		lo--;
+	}
+	return found;
+}
+
+/*
+ * subid_index_has: check whether @id is in one of the ranges of the owner
+ *                  of the index.
+ */
+bool subid_index_has (struct subid_index *idx, unsigned long id)
+{
+	return subid_index_find (idx, id, NULL);
+}
+
+/*
+ * subid_index_covers: check whether the owner of the index is authorized
+ *                     to use the range (@start .. @start+@count-1), like
+ *                     have_range().
+ *
+ * The range may span several adjacent or overlapping ranges of the owner.
+ */
+bool subid_index_covers (struct subid_index *idx,
+                         unsigned long start, unsigned long count)
+{
+	unsigned long end, last;
+
+	if (0 == count) {
+		return false;
+	}
+	end = start + count - 1;
+	if (end < start) {
+		return false;
+	}
+
+	while (subid_index_find (idx, start, &last)) {
+		if (last >= end) {
+			return true;
+		}
+		start = last + 1;
+	}
+	return false;
+}
+
+void subid_index_free (/*@only@*/struct subid_index *idx)
+{
+	size_t i;
+
+	for (i = 0; i < idx->n; i++) {
+		free (idx->entries[i].owner);
+	}
+	free (idx->entries);
+	free (idx->owner);
+	free (idx);
+}
+
 static bool append_range(struct subid_range **ranges, const struct subordinate_range *new, int n)
 {
 	if (!*ranges) {
@@ -570,7 +881,8 @@ static struct commonio_db subordinate_uid_db = {
 	false,			/* isopen */
 	false,			/* locked */
 	false,			/* readonly */
-	false			/* setname */
+	false,			/* setname */
+	NULL			/* member_index */
 };
 
 int sub_uid_setdbname (const char *filename)
@@ -618,6 +930,15 @@ bool have_sub_uids(const char *owner, uid_t start, unsigned long count)
 	return have_range (&subordinate_uid_db, owner, start, count);
 }
 
+/*
+ * sub_uid_index: index the subordinate UIDs of @owner, to check many IDs
+ *                with subid_index_has(). The database shall be open.
+ */
+/*@null@*/ /*@only@*/struct subid_index *sub_uid_index (const char *owner)
+{
+	return subid_index_new (&subordinate_uid_db, owner, ID_TYPE_UID);
+}
+
 int sub_uid_add (const char *owner, uid_t start, unsigned long count)
 {
 	if (get_subid_nss_handle())
@@ -666,7 +987,8 @@ static struct commonio_db subordinate_gid_db = {
 	false,			/* isopen */
 	false,			/* locked */
 	false,			/* readonly */
-	false			/* setname */
+	false,			/* setname */
+	NULL			/* member_index */
 };
 
 int sub_gid_setdbname (const char *filename)
@@ -709,6 +1031,15 @@ bool have_sub_gids(const char *owner, gid_t start, unsigned long count)
 	return have_range(&subordinate_gid_db, owner, start, count);
 }
 
+/*
+ * sub_gid_index: index the subordinate GIDs of @owner, to check many IDs
+ *                with subid_index_has(). The database shall be open.
+ */
+/*@null@*/ /*@only@*/struct subid_index *sub_gid_index (const char *owner)
+{
+	return subid_index_new (&subordinate_gid_db, owner, ID_TYPE_GID);
+}
+
 bool local_sub_gid_assigned(const char *owner)
 {
 	return range_exists (&subordinate_gid_db, owner);
@@ -830,6 +1161,35 @@ static bool all_digits(const char *str)
 	return true;
 }
 
+/*
+ * owner_to_uid: get the uid of a user, with getpwnam_r so that libsubid
+ *               can be used by several threads
+ */
+static bool owner_to_uid(const char *owner, uid_t *uid)
+{
+	struct passwd pwd, *result = NULL;
+	char *buffer = NULL;
+	size_t length = 0x100;
+
+	for (;;) {
+		char *tmp;
+		int status;
+
+		tmp = realloc(buffer, length);
+		if (!tmp)
+			break;
+		buffer = tmp;
+		status = getpwnam_r(owner, &pwd, buffer, length, &result);
+		if (status != ERANGE || length > ((size_t)-1 / 4))
+			break;
+		length *= 4;
+	}
+	if (result)
+		*uid = pwd.pw_uid;
+	free(buffer);
+	return (NULL != result);
+}
+
 static int append_uids(uid_t **uids, const char *owner, int n)
 {
 	uid_t owner_uid;
@@ -845,14 +1205,12 @@ static int append_uids(uid_t **uids, const char *owner, int n)
 			return -1;
 		}
 	} else {
-		struct passwd *pwd = getpwnam(owner);
-		if (NULL == pwd) {
+		if (!owner_to_uid(owner, &owner_uid)) {
 			/* Username not defined in /etc/passwd, or error occurred during lookup */
 			free(*uids);
 			*uids = NULL;
 			return -1;
 		}
-		owner_uid = pwd->pw_uid;
 	}
 
 	for (i = 0; i < n; i++) {
@@ -1046,6 +1404,759 @@ bool release_subid_range(struct subordinate_range *range, enum subid_type id_typ
 	return ret;
 }
 
+/*
+ * Snapshots of a subordinate file
+ *
+ * A snapshot is a read-only copy of a subordinate file, with indexes by
+ * owner and by ID, for processes which query the file many times (e.g.
+ * libsubid users). Unlike the commonio databases, it is not locked and
+ * it is reloaded only when the file is replaced or modified.
+ */
+struct subid_snapshot_pos {
+	unsigned long start;
+	unsigned long last;
+	unsigned long max_last;	/* highest last of the positions up to this one */
+	size_t idx;		/* index in ranges */
+};
+
+struct subid_snapshot {
+	pthread_rwlock_t lock;	/* write locked to (re)load the snapshot */
+	char *filename;
+	enum subid_type id_type;
+	bool loaded;
+	struct stat sb;		/* of the loaded file, zeroed if missing */
+	/*@null@*/char *data;	/* content of the file */
+	size_t n;
+	/*@null@*/struct subordinate_range *ranges;	/* in file order */
+	/*@null@*/struct subid_snapshot_pos *by_start;
+	size_t npos;		/* ranges in by_start (the empty ones are not) */
+	size_t nbuckets;	/* power of 2 */
+	/*@null@*/size_t *buckets;	/* index + 1 of the first range of an owner */
+	/*@null@*/size_t *next;	/* index + 1 of the next range of the owner */
+};
+
+static void subid_snapshot_clear (struct subid_snapshot *snap)
+{
+	free (snap->data);
+	free (snap->ranges);
+	free (snap->by_start);
+	free (snap->buckets);
+	free (snap->next);
+	snap->data = NULL;
+	snap->ranges = NULL;
+	snap->by_start = NULL;
+	snap->buckets = NULL;
+	snap->next = NULL;
+	snap->n = 0;
+	snap->npos = 0;
+	snap->nbuckets = 0;
+	snap->loaded = false;
+}
+
+static int subid_snapshot_pos_cmp (const void *p1, const void *p2)
+{
+	const struct subid_snapshot_pos *pos1 = p1;
+	const struct subid_snapshot_pos *pos2 = p2;
+
+	if (pos1->start != pos2->start) {
+		return (pos1->start < pos2->start) ? -1 : 1;
+	}
+	return (pos1->idx < pos2->idx) ? -1 : (pos1->idx > pos2->idx);
+}
+
+/*
+ * subid_snapshot_load: parse the content of the file and build the
+ *                      indexes.
+ */
+static int subid_snapshot_load (struct subid_snapshot *snap, int fd,
+                                const struct stat *sb)
+{
+	char *line, *end;
+	size_t alloc = 0;
+	size_t len = 0;
+	size_t i;
+
+	snap->data = malloc ((size_t) sb->st_size + 1);
+	if (NULL == snap->data) {
+		return -1;
+	}
+	while (len < (size_t) sb->st_size) {
+		ssize_t r = read (fd, snap->data + len, (size_t) sb->st_size - len);
+
+		if (r < 0) {
+			if (EINTR == errno) {
+				continue;
+			}
+			return -1;
+		}
+		if (0 == r) {
+			break;
+		}
+		len += (size_t) r;
+	}
+	snap->data[len] = '\0';
+
+	for (line = snap->data; '\0' != *line; line = end) {
+		struct subordinate_range range;
+
+		end = strchr (line, '\n');
+		if (NULL != end) {
+			*end = '\0';
+			end++;
+		} else {
+			end = line + strlen (line);
+		}
+		if (!subordinate_parse_r (line, &range)) {
+			continue;
+		}
+		if (snap->n == alloc) {
+			struct subordinate_range *tmp;
+
+			alloc = (0 == alloc) ? 64 : alloc * 2;
+			tmp = realloc (snap->ranges, alloc * sizeof *tmp);
+			if (NULL == tmp) {
+				return -1;
+			}
+			snap->ranges = tmp;
+		}
+		snap->ranges[snap->n] = range;
+		snap->n++;
+	}
+
+	if (0 == snap->n) {
+		return 0;
+	}
+
+	/* Index by ID */
+	snap->by_start = malloc (snap->n * sizeof *snap->by_start);
+	if (NULL == snap->by_start) {
+		return -1;
+	}
+	snap->npos = 0;
+	for (i = 0; i < snap->n; i++) {
+		struct subid_snapshot_pos *pos = &snap->by_start[snap->npos];
+
+		/* An empty range includes no ID */
+		if (0 == snap->ranges[i].count) {
+			continue;
+		}
+		pos->start = snap->ranges[i].start;
+		pos->last = snap->ranges[i].start + snap->ranges[i].count - 1;
+		pos->idx = i;
+		snap->npos++;
+	}
+	qsort (snap->by_start, snap->npos, sizeof *snap->by_start,
+	       subid_snapshot_pos_cmp);
+	for (i = 0; i < snap->npos; i++) {
+		snap->by_start[i].max_last = snap->by_start[i].last;
+		if (   (0 != i)
+		    && (snap->by_start[i - 1].max_last > snap->by_start[i].last)) {
+			snap->by_start[i].max_last = snap->by_start[i - 1].max_last;
+		}
+	}
+
+	/* Index by owner, keeping the file order for each owner */
+	snap->nbuckets = 16;
+	while (snap->nbuckets < snap->n) {
+		snap->nbuckets *= 2;
+	}
+	snap->buckets = calloc (snap->nbuckets, sizeof *snap->buckets);
+	snap->next = calloc (snap->n, sizeof *snap->next);
+	if ((NULL == snap->buckets) || (NULL == snap->next)) {
+		return -1;
+	}
+	for (i = snap->n; i > 0; i--) {
+		size_t *b = &snap->buckets[  commonio_hash (snap->ranges[i - 1].owner)
+		                           & (snap->nbuckets - 1)];
+
+		snap->next[i - 1] = *b;
+		*b = i;
+	}
+
+	return 0;
+}
+
+/*
+ * subid_snapshot_new: create a snapshot of @filename, the database of
+ *                     @id_type. It is loaded on the first query.
+ */
+/*@null@*/ /*@only@*/struct subid_snapshot *subid_snapshot_new (const char *filename,
+                                                             enum subid_type id_type)
+{
+	struct subid_snapshot *snap;
+
+	snap = calloc (1, sizeof *snap);
+	if (NULL == snap) {
+		return NULL;
+	}
+	snap->filename = strdup (filename);
+	if (NULL == snap->filename) {
+		free (snap);
+		return NULL;
+	}
+	if (pthread_rwlock_init (&snap->lock, NULL) != 0) {
+		free (snap->filename);
+		free (snap);
+		return NULL;
+	}
+	snap->id_type = id_type;
+	return snap;
+}
+
+void subid_snapshot_free (/*@only@*/struct subid_snapshot *snap)
+{
+	subid_snapshot_clear (snap);
+	(void) pthread_rwlock_destroy (&snap->lock);
+	free (snap->filename);
+	free (snap);
+}
+
+/*
+ * subid_snapshot_refresh: (re)load the snapshot if the file changed
+ *
+ * A missing file is an empty database.
+ *
+ * Returns 0 on success, -1 on failure (errno set).
+ */
+static int subid_snapshot_refresh (struct subid_snapshot *snap)
+{
+	struct stat sb;
+	int fd;
+
+	fd = open (snap->filename, O_RDONLY | O_NOCTTY | O_CLOEXEC);
+	if (fd < 0) {
+		if (ENOENT != errno) {
+			return -1;
+		}
+		memzero (&sb, sizeof sb);
+	} else if (fstat (fd, &sb) != 0) {
+		int saved_errno = errno;
+		(void) close (fd);
+		errno = saved_errno;
+		return -1;
+	}
+
+	if (snap->loaded && cache_same_file (&sb, &snap->sb)) {
+		if (fd >= 0) {
+			(void) close (fd);
+		}
+		return 0;
+	}
+
+	subid_snapshot_clear (snap);
+	if (fd >= 0) {
+		int ret = subid_snapshot_load (snap, fd, &sb);
+		int saved_errno = errno;
+
+		(void) close (fd);
+		if (0 != ret) {
+			subid_snapshot_clear (snap);
+			errno = (0 != saved_errno) ? saved_errno : ENOMEM;
+			return -1;
+		}
+	}
+	snap->sb = sb;
+	snap->loaded = true;
+	return 0;
+}
+
+/*
+ * subid_snapshot_rdlock: read lock the snapshot, (re)loading it first if
+ *                        the file changed
+ *
+ * Queries on the same snapshot run concurrently. Only the reload is
+ * serialized, and it is skipped by the threads which find that another
+ * thread already did it.
+ *
+ * Returns 0 on success, with the snapshot read locked, -1 on failure
+ * (errno set).
+ */
+static int subid_snapshot_rdlock (struct subid_snapshot *snap)
+{
+	struct stat sb;
+	int ret;
+
+	if (stat (snap->filename, &sb) != 0) {
+		if (ENOENT != errno) {
+			return -1;
+		}
+		memzero (&sb, sizeof sb);
+	}
+
+	ret = pthread_rwlock_rdlock (&snap->lock);
+	if (0 != ret) {
+		errno = ret;
+		return -1;
+	}
+	if (snap->loaded && cache_same_file (&sb, &snap->sb)) {
+		return 0;
+	}
+	(void) pthread_rwlock_unlock (&snap->lock);
+
+	ret = pthread_rwlock_wrlock (&snap->lock);
+	if (0 != ret) {
+		errno = ret;
+		return -1;
+	}
+	ret = subid_snapshot_refresh (snap);
+	(void) pthread_rwlock_unlock (&snap->lock);
+	if (0 != ret) {
+		return -1;
+	}
+
+	/*
+	 * The file may change again before the read lock is taken. The
+	 * snapshot is still consistent, and the change will be seen by the
+	 * next query.
+	 */
+	ret = pthread_rwlock_rdlock (&snap->lock);
+	if (0 != ret) {
+		errno = ret;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * subid_snapshot_ranges: list the ranges of @owner, in file order
+ *
+ * The snapshot is reloaded first if the file changed. If a subid NSS
+ * module is configured, it is queried instead.
+ *
+ * Returns the number of ranges, or -1 on failure. The caller shall free
+ * *ranges.
+ */
+int subid_snapshot_ranges (struct subid_snapshot *snap,
+                           const char *owner, struct subid_range **ranges)
+{
+	struct subid_nss_ops *h;
+	int count = 0;
+	size_t i;
+
+	*ranges = NULL;
+	h = get_subid_nss_handle ();
+	if (NULL != h) {
+		if (h->list_owner_ranges (owner, snap->id_type, ranges, &count)
+		    != SUBID_STATUS_SUCCESS) {
+			return -1;
+		}
+		return count;
+	}
+
+	if (subid_snapshot_rdlock (snap) != 0) {
+		return -1;
+	}
+	if (0 == snap->n) {
+		(void) pthread_rwlock_unlock (&snap->lock);
+		return 0;
+	}
+
+	for (i = snap->buckets[commonio_hash (owner) & (snap->nbuckets - 1)];
+	     0 != i;
+	     i = snap->next[i - 1]) {
+		const struct subordinate_range *range = &snap->ranges[i - 1];
+
+		if (0 != strcmp (range->owner, owner)) {
+			continue;
+		}
+		if (!append_range (ranges, range, count++)) {
+			free (*ranges);
+			*ranges = NULL;
+			count = -1;
+			break;
+		}
+	}
+	(void) pthread_rwlock_unlock (&snap->lock);
+	return count;
+}
+
+static int size_t_cmp (const void *p1, const void *p2)
+{
+	const size_t *i1 = p1;
+	const size_t *i2 = p2;
+
+	return (*i1 < *i2) ? -1 : (*i1 > *i2);
+}
+
+/*
+ * snapshot_find_owners: find the owners of the ranges which include @id,
+ *                       in a loaded snapshot
+ */
+static int snapshot_find_owners (const struct subid_snapshot *snap,
+                                 unsigned long id, uid_t **uids)
+{
+	size_t lo = 0, hi = snap->npos;
+	size_t *found = NULL;
+	size_t nfound = 0;
+	size_t i;
+	int n = 0;
+
+	*uids = NULL;
+
+	/* Find the first position starting after id */
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+
+		if (snap->by_start[mid].start <= id) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+
+	/* Collect the ranges which include id */
+	for (; (lo > 0) && (snap->by_start[lo - 1].max_last >= id); lo--) {
+		size_t *tmp;
+
+		if (snap->by_start[lo - 1].last < id) {
+			continue;
+		}
+		tmp = realloc (found, (nfound + 1) * sizeof *found);
+		if (NULL == tmp) {
+			free (found);
+			return -1;
+		}
+		found = tmp;
+		found[nfound] = snap->by_start[lo - 1].idx;
+		nfound++;
+	}
+
+	if (nfound > 1) {
+		qsort (found, nfound, sizeof *found, size_t_cmp);
+	}
+	for (i = 0; i < nfound; i++) {
+		n = append_uids (uids, snap->ranges[found[i]].owner, n);
+		if (n < 0) {
+			break;
+		}
+	}
+	free (found);
+	return n;
+}
+
+/*
+ * subid_snapshot_owners: find the owners of the ranges which include @id,
+ *                        in file order
+ *
+ * The snapshot is reloaded first if the file changed. If a subid NSS
+ * module is configured, it is queried instead.
+ *
+ * Returns the number of owners, or -1 on failure. The caller shall free
+ * *uids.
+ */
+int subid_snapshot_owners (struct subid_snapshot *snap,
+                           unsigned long id, uid_t **uids)
+{
+	struct subid_nss_ops *h;
+	int n = 0;
+
+	*uids = NULL;
+	h = get_subid_nss_handle ();
+	if (NULL != h) {
+		if (h->find_subid_owners (id, snap->id_type, uids, &n)
+		    != SUBID_STATUS_SUCCESS) {
+			return -1;
+		}
+		return n;
+	}
+
+	if (subid_snapshot_rdlock (snap) != 0) {
+		return -1;
+	}
+	n = snapshot_find_owners (snap, id, uids);
+	(void) pthread_rwlock_unlock (&snap->lock);
+	return n;
+}
+
+/*
+ * Grow array, of *alloc elements of size size, to hold at least n > 0
+ * elements.
+ *
+ * Returns the new array, or NULL on failure (array is left untouched).
+ */
+static /*@null@*/void *snapshot_grow (/*@null@*/void *array, size_t *alloc,
+                                      size_t n, size_t size)
+{
+	void *tmp;
+	size_t new_alloc;
+
+	if (n <= *alloc) {
+		return array;
+	}
+	new_alloc = (0 == *alloc) ? 16 : *alloc * 2;
+	if (new_alloc < n) {
+		new_alloc = n;
+	}
+	tmp = realloc (array, new_alloc * size);
+	if (NULL != tmp) {
+		*alloc = new_alloc;
+	}
+	return tmp;
+}
+
+/*
+ * subid_snapshot_ranges_batch: list the ranges of each of @owners
+ *
+ * The ranges are returned in the order of @owners, and in file order for
+ * each owner. Their owner points to the string of @owners.
+ * If a subid NSS module is configured, it is queried instead, in one call
+ * if it provides list_owners_ranges.
+ *
+ * Returns the number of ranges, or -1 on failure. The caller shall free
+ * *ranges.
+ */
+int subid_snapshot_ranges_batch (struct subid_snapshot *snap,
+                                 const char *const *owners, size_t n,
+                                 struct subordinate_range **ranges)
+{
+	struct subid_nss_ops *h;
+	void *tmp;
+	size_t alloc = 0;
+	size_t count = 0;
+	size_t i;
+
+	*ranges = NULL;
+	h = get_subid_nss_handle ();
+	if ((NULL != h) && (NULL != h->list_owners_ranges)) {
+		int nss_count = 0;
+
+		if (h->list_owners_ranges (owners, n, snap->id_type,
+		                           ranges, &nss_count)
+		    != SUBID_STATUS_SUCCESS) {
+			return -1;
+		}
+		return nss_count;
+	}
+	if ((NULL == h) && (subid_snapshot_rdlock (snap) != 0)) {
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		if (NULL != h) {
+			struct subid_range *owner_ranges = NULL;
+			int nss_count = 0;
+			int j;
+
+			if (h->list_owner_ranges (owners[i], snap->id_type,
+			                          &owner_ranges, &nss_count)
+			    != SUBID_STATUS_SUCCESS) {
+				goto fail;
+			}
+			if (0 == nss_count) {
+				free (owner_ranges);
+				continue;
+			}
+			tmp = snapshot_grow (*ranges, &alloc,
+			                     count + (size_t) nss_count,
+			                     sizeof **ranges);
+			if (NULL == tmp) {
+				free (owner_ranges);
+				goto fail;
+			}
+			*ranges = tmp;
+			for (j = 0; j < nss_count; j++) {
+				(*ranges)[count].owner = owners[i];
+				(*ranges)[count].start = owner_ranges[j].start;
+				(*ranges)[count].count = owner_ranges[j].count;
+				count++;
+			}
+			free (owner_ranges);
+		} else if (0 != snap->n) {
+			size_t k;
+
+			for (k = snap->buckets[  commonio_hash (owners[i])
+			                       & (snap->nbuckets - 1)];
+			     0 != k;
+			     k = snap->next[k - 1]) {
+				const struct subordinate_range *range;
+
+				range = &snap->ranges[k - 1];
+				if (0 != strcmp (range->owner, owners[i])) {
+					continue;
+				}
+				tmp = snapshot_grow (*ranges, &alloc,
+				                     count + 1, sizeof **ranges);
+				if (NULL == tmp) {
+					goto fail;
+				}
+				*ranges = tmp;
+				(*ranges)[count].owner = owners[i];
+				(*ranges)[count].start = range->start;
+				(*ranges)[count].count = range->count;
+				count++;
+			}
+		}
+	}
+	if (NULL == h) {
+		(void) pthread_rwlock_unlock (&snap->lock);
+	}
+	return (int) count;
+
+      fail:
+	if (NULL == h) {
+		(void) pthread_rwlock_unlock (&snap->lock);
+	}
+	free (*ranges);
+	*ranges = NULL;
+	return -1;
+}
+
+/*
+ * subid_snapshot_owners_batch: find the owners of each of @ids
+ *
+ * An (ID, owner) pair is returned for each owner of each ID, in the order
+ * of @ids.
+ * If a subid NSS module is configured, it is queried instead, in one call
+ * if it provides find_ids_owners.
+ *
+ * Returns the number of pairs, or -1 on failure. The caller shall free
+ * *owners.
+ */
+int subid_snapshot_owners_batch (struct subid_snapshot *snap,
+                                 const unsigned long *ids, size_t n,
+                                 struct subid_owner **owners)
+{
+	struct subid_nss_ops *h;
+	void *tmp;
+	size_t alloc = 0;
+	size_t count = 0;
+	size_t i;
+
+	*owners = NULL;
+	h = get_subid_nss_handle ();
+	if ((NULL != h) && (NULL != h->find_ids_owners)) {
+		int nss_count = 0;
+
+		if (h->find_ids_owners (ids, n, snap->id_type,
+		                        owners, &nss_count)
+		    != SUBID_STATUS_SUCCESS) {
+			return -1;
+		}
+		return nss_count;
+	}
+	if ((NULL == h) && (subid_snapshot_rdlock (snap) != 0)) {
+		return -1;
+	}
+
+	for (i = 0; i < n; i++) {
+		uid_t *uids = NULL;
+		int nuids = 0;
+		int j;
+
+		if (NULL != h) {
+			if (h->find_subid_owners (ids[i], snap->id_type,
+			                          &uids, &nuids)
+			    != SUBID_STATUS_SUCCESS) {
+				goto fail;
+			}
+		} else {
+			nuids = snapshot_find_owners (snap, ids[i], &uids);
+			if (nuids < 0) {
+				goto fail;
+			}
+		}
+		if (0 == nuids) {
+			free (uids);
+			continue;
+		}
+		tmp = snapshot_grow (*owners, &alloc,
+		                     count + (size_t) nuids, sizeof **owners);
+		if (NULL == tmp) {
+			free (uids);
+			goto fail;
+		}
+		*owners = tmp;
+		for (j = 0; j < nuids; j++) {
+			(*owners)[count].id = ids[i];
+			(*owners)[count].owner = uids[j];
+			count++;
+		}
+		free (uids);
+	}
+	if (NULL == h) {
+		(void) pthread_rwlock_unlock (&snap->lock);
+	}
+	return (int) count;
+
+      fail:
+	if (NULL == h) {
+		(void) pthread_rwlock_unlock (&snap->lock);
+	}
+	free (*owners);
+	*owners = NULL;
+	return -1;
+}
+
+/*
+ * subid_snapshot_all_ranges: list all the ranges, in file order
+ *
+ * The owners are allocated in the same block as the array, which is
+ * freed with a single free().
+ * If a subid NSS module is configured, it is queried instead. It fails
+ * if the module does not provide list_all_ranges.
+ *
+ * Returns the number of ranges, or -1 on failure.
+ */
+int subid_snapshot_all_ranges (struct subid_snapshot *snap,
+                               struct subordinate_range **ranges)
+{
+	struct subid_nss_ops *h;
+	struct subordinate_range *src;
+	struct subordinate_range *nss_ranges = NULL;
+	size_t n;
+	size_t size;
+	size_t i;
+	char *cp;
+
+	*ranges = NULL;
+	h = get_subid_nss_handle ();
+	if (NULL != h) {
+		int nss_count = 0;
+
+		if (   (NULL == h->list_all_ranges)
+		    || (h->list_all_ranges (snap->id_type, &nss_ranges, &nss_count)
+		        != SUBID_STATUS_SUCCESS)) {
+			return -1;
+		}
+		src = nss_ranges;
+		n = (size_t) nss_count;
+	} else {
+		if (subid_snapshot_rdlock (snap) != 0) {
+			return -1;
+		}
+		src = snap->ranges;
+		n = snap->n;
+	}
+
+	if (0 != n) {
+		size = n * sizeof **ranges;
+		for (i = 0; i < n; i++) {
+			size += strlen (src[i].owner) + 1;
+		}
+		*ranges = malloc (size);
+	}
+	if (NULL != *ranges) {
+		cp = (char *) (*ranges + n);
+		for (i = 0; i < n; i++) {
+			strcpy (cp, src[i].owner);
+			(*ranges)[i].owner = cp;
+			(*ranges)[i].start = src[i].start;
+			(*ranges)[i].count = src[i].count;
+			cp += strlen (cp) + 1;
+		}
+	}
+
+	if (NULL != h) {
+		for (i = 0; i < n; i++) {
+			free ((char *) nss_ranges[i].owner);
+		}
+		free (nss_ranges);
+	} else {
+		(void) pthread_rwlock_unlock (&snap->lock);
+	}
+	return ((0 != n) && (NULL == *ranges)) ? -1 : (int) n;
+}
+
 #else				/* !ENABLE_SUBIDS */
 extern int errno;		/* warning: ANSI C forbids an empty source file */
 #endif				/* !ENABLE_SUBIDS */
@@ -15,6 +15,12 @@
 
 extern int sub_uid_close(void);
 extern bool have_sub_uids(const char *owner, uid_t start, unsigned long count);
+struct subid_index;
+extern /*@null@*/ /*@only@*/struct subid_index *sub_uid_index (const char *owner);
+extern bool subid_index_has (struct subid_index *idx, unsigned long id);
+extern bool subid_index_covers (struct subid_index *idx,
+                                unsigned long start, unsigned long count);
+extern void subid_index_free (/*@only@*/struct subid_index *idx);
 extern bool sub_uid_file_present (void);
 extern bool local_sub_uid_assigned(const char *owner);
 extern int sub_uid_lock (void);
@@ -31,8 +37,26 @@ extern bool release_subid_range(struct subordinate_range *range, enum subid_type
 extern int find_subid_owners(unsigned long id, enum subid_type id_type, uid_t **uids);
 extern void free_subordinate_ranges(struct subordinate_range **ranges, int count);
 
+struct subid_snapshot;
+extern /*@null@*/ /*@only@*/struct subid_snapshot *subid_snapshot_new (const char *filename,
+                                                                    enum subid_type id_type);
+extern void subid_snapshot_free (/*@only@*/struct subid_snapshot *snap);
+extern int subid_snapshot_ranges (struct subid_snapshot *snap,
+                                  const char *owner, struct subid_range **ranges);
+extern int subid_snapshot_owners (struct subid_snapshot *snap,
+                                  unsigned long id, uid_t **uids);
+extern int subid_snapshot_ranges_batch (struct subid_snapshot *snap,
+                                        const char *const *owners, size_t n,
+                                        struct subordinate_range **ranges);
+extern int subid_snapshot_owners_batch (struct subid_snapshot *snap,
+                                        const unsigned long *ids, size_t n,
+                                        struct subid_owner **owners);
+extern int subid_snapshot_all_ranges (struct subid_snapshot *snap,
+                                      struct subordinate_range **ranges);
+
 extern int sub_gid_close(void);
 extern bool have_sub_gids(const char *owner, gid_t start, unsigned long count);
+extern /*@null@*/ /*@only@*/struct subid_index *sub_gid_index (const char *owner);
 extern bool sub_gid_file_present (void);
 extern bool local_sub_gid_assigned(const char *owner);
 extern int sub_gid_lock (void);
@@ -33,6 +33,7 @@
 
 #include <config.h>
 #include "defines.h"
+#include <ctype.h>
 #include <stdio.h>
 #include "getdef.h"
 #include "prototypes.h"
@@ -40,8 +41,21 @@
 #ident "$Id$"
 
 /* local function prototypes */
+static bool is_listed_parse (char *line, const char **name,
+                             const char **value);
 static bool is_listed (const char *cfgin, const char *tty, bool def);
 
+/*
+ * The console file lists one tty per line.
+ */
+static bool is_listed_parse (char *line, const char **name,
+                             unused const char **value)
+{
+	line[strcspn (line, "\n")] = '\0';
+	*name = line;
+	return true;
+}
+
 /*
  * This is now rather generic function which decides if "tty" is listed
  * under "cfgin" in config (directly or indirectly). Fallback to default if
@@ -52,6 +66,8 @@ static bool is_listed (const char *cfgin, const char *tty, bool def)
 	FILE *fp;
 	char buf[1024], *s;
 	const char *cons;
+	struct nametable *table;
+	bool listed;
 
 	/*
 	 * If the CONSOLE configuration definition isn't given,
@@ -94,23 +110,29 @@ static bool is_listed (const char *cfgin, const char *tty, bool def)
 	}
 
 	/*
-	 * See if this tty is listed in the console file.
+	 * See if this tty is listed in the console file. The file is
+	 * looked up in its compiled form, cached under the lower case name
+	 * of the configuration item.
 	 */
 
-	while (fgets (buf, (int) sizeof (buf), fp) != NULL) {
-		buf[strlen (buf) - 1] = '\0';
-		if (strcmp (buf, tty) == 0) {
-			(void) fclose (fp);
-			return true;
-		}
+	strncpy (buf, cfgin, sizeof (buf));
+	buf[sizeof (buf) - 1] = '\0';
+	for (s = buf; '\0' != *s; s++) {
+		*s = (char) tolower ((unsigned char) *s);
 	}
-
-	/*
-	 * This tty isn't a console.
-	 */
-
+	table = nametable_load (fp, buf, is_listed_parse);
 	(void) fclose (fp);
-	return false;
+	if (NULL == table) {
+		/*
+		 * Do not call everything a console if the file could be
+		 * opened but not read.
+		 */
+		return false;
+	}
+	listed = (NULL != nametable_find (table, tty));
+	nametable_free (table);
+
+	return listed;
 }
 
 /*
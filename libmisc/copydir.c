@@ -227,10 +227,10 @@ static /*@exposed@*/ /*@null@*/struct link_name *check_link (const char *name, c
  *	The same logic applies for the group-ownership and
  *	old_gid/new_gid.
  */
-int copy_tree (const char *src_root, const char *dst_root,
-               bool copy_root, bool reset_selinux,
-               uid_t old_uid, uid_t new_uid,
-               gid_t old_gid, gid_t new_gid)
+static int do_copy_tree (const char *src_root, const char *dst_root,
+                         bool copy_root, bool reset_selinux,
+                         uid_t old_uid, uid_t new_uid,
+                         gid_t old_gid, gid_t new_gid)
 {
 	int err = 0;
 	bool set_orig = false;
@@ -355,6 +355,21 @@ int copy_tree (const char *src_root, const char *dst_root,
 	return err;
 }
 
+int copy_tree (const char *src_root, const char *dst_root,
+               bool copy_root, bool reset_selinux,
+               uid_t old_uid, uid_t new_uid,
+               gid_t old_gid, gid_t new_gid)
+{
+	struct instr_mark mark;
+	int err;
+
+	instr_begin (&mark, "copy_tree");
+	err = do_copy_tree (src_root, dst_root, copy_root, reset_selinux,
+	                    old_uid, new_uid, old_gid, new_gid);
+	instr_end (&mark);
+	return err;
+}
+
 /*
  * copy_entry - copy the entry of a directory
  *
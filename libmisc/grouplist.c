@@ -0,0 +1,151 @@
+#include <config.h>
+
+#ident "$Id$"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <limits.h>
+#include <grp.h>
+#include "prototypes.h"
+#include "defines.h"
+
+#ifdef HAVE_GETGROUPLIST
+/*
+ * Ask the NSS modules for the groups of user with getgrouplist(), which
+ * lets them use their initgroups backend instead of a full enumeration
+ * of the groups.
+ *
+ * Return -1 if getgrouplist() failed for another reason than a too
+ * small buffer.
+ */
+static int grouplist_nss (const char *user, gid_t group,
+                          gid_t **groups, int *ngroups)
+{
+	int size = *ngroups;
+	int n;
+
+	for (;;) {
+		gid_t *tmp;
+
+		tmp = (gid_t *) realloc (*groups, (size_t) size * sizeof (gid_t));
+		if (NULL == tmp) {
+			errno = ENOMEM;
+			return -1;
+		}
+		*groups = tmp;
+
+		n = size;
+		if (getgrouplist (user, group, *groups, &n) != -1) {
+			*ngroups = n;
+			return 0;
+		}
+
+		/*
+		 * The buffer was too small. n is the number of groups
+		 * found, unless the libc does not report it.
+		 */
+		if (n > size) {
+			size = n;
+		} else if (size < (INT_MAX / 2)) {
+			size *= 2;
+		} else {
+			errno = ERANGE;
+			return -1;
+		}
+	}
+}
+#endif				/* HAVE_GETGROUPLIST */
+
+/*
+ * Fallback: enumerate all the groups.
+ */
+static int grouplist_enum (const char *user, gid_t group,
+                           gid_t **groups, int *ngroups)
+{
+	struct group *grp;
+	int size = *ngroups;
+	int n = 0;
+
+	if (size < 1) {
+		size = 1;
+	}
+	*groups = (gid_t *) malloc ((size_t) size * sizeof (gid_t));
+	if (NULL == *groups) {
+		errno = ENOMEM;
+		return -1;
+	}
+	(*groups)[n] = group;
+	n++;
+
+	setgrent ();
+	while ((grp = getgrent ()) != NULL) {
+		int i;
+
+		if (!is_on_list (grp->gr_mem, user)) {
+			continue;
+		}
+		for (i = 0; (i < n) && ((*groups)[i] != grp->gr_gid); i++);
+		if (i < n) {
+			continue;
+		}
+		if (n == size) {
+			gid_t *tmp;
+
+			size *= 2;
+			tmp = (gid_t *) realloc (*groups,
+			                         (size_t) size * sizeof (gid_t));
+			if (NULL == tmp) {
+				endgrent ();
+				errno = ENOMEM;
+				return -1;
+			}
+			*groups = tmp;
+		}
+		(*groups)[n] = grp->gr_gid;
+		n++;
+	}
+	endgrent ();
+
+	*ngroups = n;
+	return 0;
+}
+
+/*
+ * get_grouplist - get the groups of a user
+ *
+ *	Return a newly allocated array with the GIDs of the groups user is
+ *	a member of, starting with group (normally the primary group of
+ *	the user), and store the number of GIDs in *ngroups.
+ *
+ *	On input, *ngroups is the expected number of groups, used to size
+ *	the first buffer (0 if unknown).
+ *
+ *	Return NULL on failure (errno set).
+ */
+/*@null@*/ /*@only@*/gid_t *get_grouplist (const char *user, gid_t group,
+                                          int *ngroups)
+{
+	gid_t *groups = NULL;
+
+	if (*ngroups < 16) {
+		*ngroups = 16;
+	}
+
+#ifdef HAVE_GETGROUPLIST
+	if (grouplist_nss (user, group, &groups, ngroups) == 0) {
+		return groups;
+	}
+	if (ENOMEM == errno) {
+		free (groups);
+		return NULL;
+	}
+	free (groups);
+	groups = NULL;
+#endif				/* HAVE_GETGROUPLIST */
+
+	if (grouplist_enum (user, group, &groups, ngroups) != 0) {
+		free (groups);
+		return NULL;
+	}
+	return groups;
+}
@@ -41,19 +41,32 @@
 #include "defines.h"
 #include "prototypes.h"
 #include "getdef.h"
+/*
+ * The hushed logins file lists one user name or shell per line.
+ */
+static bool hushed_parse (char *line, const char **name,
+                          unused const char **value)
+{
+	line[strcspn (line, "\n")] = '\0';
+	*name = line;
+	return true;
+}
+
 /*
  * hushed - determine if a user receives login messages
  *
  * Look in the hushed-logins file (or user's home directory) to see
  * if the user is to receive the login-time messages.
+ *
+ * pw is the password entry of the user, if the caller has it already.
  */
-bool hushed (const char *username)
+bool hushed (const char *username, /*@null@*/const struct passwd *pw)
 {
-	struct passwd *pw;
 	const char *hushfile;
 	char buf[BUFSIZ];
 	bool found;
 	FILE *fp;
+	struct nametable *table;
 
 	/*
 	 * Get the name of the file to use.  If this option is not
@@ -65,9 +78,11 @@ bool hushed (const char *username)
 		return false;
 	}
 
-	pw = getpwnam (username);
 	if (NULL == pw) {
-		return false;
+		pw = getpwnam (username);
+		if (NULL == pw) {
+			return false;
+		}
 	}
 
 	/*
@@ -81,20 +96,21 @@ bool hushed (const char *username)
 	}
 
 	/*
-	 * If this is a fully rooted path then go through the file
-	 * and see if this user, or its shell is in there.
+	 * If this is a fully rooted path then see if this user, or its
+	 * shell is in the compiled file.
 	 */
 
 	fp = fopen (hushfile, "r");
 	if (NULL == fp) {
 		return false;
 	}
-	for (found = false; !found && (fgets (buf, (int) sizeof buf, fp) == buf);) {
-		buf[strcspn (buf, "\n")] = '\0';
-		found = (strcmp (buf, pw->pw_shell) == 0) ||
-		        (strcmp (buf, pw->pw_name) == 0);
-	}
+	table = nametable_load (fp, "hushlogins", hushed_parse);
 	(void) fclose (fp);
+	if (NULL == table) {
+		return false;
+	}
+	found =    (NULL != nametable_find (table, pw->pw_shell))
+	        || (NULL != nametable_find (table, pw->pw_name));
+	nametable_free (table);
 	return found;
 }
-
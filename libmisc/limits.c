@@ -45,6 +45,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <stdint.h>
 #include <ctype.h>
 #include "prototypes.h"
 #include "defines.h"
@@ -395,111 +396,384 @@ static int do_user_limits (const char *buf, const char *name)
 	return retval;
 }
 
-/* Check if user uname is in the group gname.
- * Can I be sure that gr_mem contains no UID as string?
- * Returns true when user is in the group, false when not.
- * Any error is treated as false.
+/*
+ * Compiled limits file
+ *
+ * Parsing LIMITS_FILE and resolving every @group line on each login does
+ * not scale to large limits files. The file is compiled into a hash
+ * table of its names (user, @group or *), which is cached in CACHE_DIR
+ * until LIMITS_FILE changes:
+ *
+ *	struct limits_db
+ *	uint32_t buckets[nbuckets]	index + 1 of the first entry
+ *	struct limits_entry entries[nentries]
+ *	char strings[strings_len]
+ *
+ * The entries already apply the precedence rules of the file: the first
+ * line of a user is kept, and the last line of a group or of the
+ * default limits.
  */
-static bool user_in_group (const char *uname, const char *gname)
+#define LIMITS_CACHE	"limits"
+#define LIMITS_MAGIC	"limits1"
+
+struct limits_db {
+	uint32_t nbuckets;	/* power of 2 */
+	uint32_t nentries;
+	uint32_t ngroups;	/* number of @group entries */
+	uint32_t strings_len;
+};
+
+struct limits_entry {
+	uint32_t name;		/* offset in strings */
+	uint32_t limits;	/* offset in strings */
+	uint32_t line;		/* line number, to order the @group lines */
+	uint32_t next;		/* index + 1 of the next entry in the bucket */
+};
+
+static bool limits_valid (const void *db, size_t len)
 {
-	struct group *groupdata;
+	const struct limits_db *hdr = db;
+
+	return    (len >= sizeof *hdr)
+	       && (0 != hdr->nbuckets)
+	       && ((hdr->nbuckets & (hdr->nbuckets - 1)) == 0)
+	       && (len == sizeof *hdr
+	                  + hdr->nbuckets * sizeof (uint32_t)
+	                  + hdr->nentries * sizeof (struct limits_entry)
+	                  + hdr->strings_len)
+	       /* The strings are NUL terminated */
+	       && (   (0 == hdr->strings_len)
+	           || ('\0' == ((const char *) db)[len - 1]));
+}
 
-	if (uname == NULL || gname == NULL) {
-		return false;
+/*
+ * Look up name in a compiled limits file.
+ */
+static /*@null@*/const struct limits_entry *limits_find (const void *db,
+                                                         size_t len,
+                                                         const char *name)
+{
+	const struct limits_db *hdr = db;
+	const uint32_t *buckets;
+	const struct limits_entry *entries;
+	const char *strings;
+	uint32_t i;
+
+	if (!limits_valid (db, len)) {
+		return NULL;
 	}
+	buckets = (const uint32_t *) (hdr + 1);
+	entries = (const struct limits_entry *) (buckets + hdr->nbuckets);
+	strings = (const char *) (entries + hdr->nentries);
+
+	i = buckets[commonio_hash (name) & (hdr->nbuckets - 1)];
+	while ((0 != i) && (i <= hdr->nentries)) {
+		const struct limits_entry *e = &entries[i - 1];
 
-	/* We are not claiming to be re-entrant!
-	 * In case of paranoia or a multithreaded login program,
-	 * one needs to add some mess for getgrnam_r. */
-	groupdata = getgrnam (gname);
-	if (NULL == groupdata) {
-		SYSLOG ((LOG_WARN, "Nonexisting group `%s' in limits file.",
-		         gname));
-		return false;
+		if (   (e->name >= hdr->strings_len)
+		    || (e->limits >= hdr->strings_len)) {
+			return NULL;
+		}
+		if (strncmp (strings + e->name, name,
+		             hdr->strings_len - e->name) == 0) {
+			return e;
+		}
+		i = e->next;
 	}
+	return NULL;
+}
+
+static const char *limits_string (const void *db, const struct limits_entry *e)
+{
+	const struct limits_db *hdr = db;
 
-	return is_on_list (groupdata->gr_mem, uname);
+	return (const char *) (hdr + 1)
+	       + hdr->nbuckets * sizeof (uint32_t)
+	       + hdr->nentries * sizeof (struct limits_entry)
+	       + e->limits;
 }
 
-static int setup_user_limits (const char *uname)
+/*
+ * Compile the limits file.
+ *
+ * Return the compiled file (to be freed by the caller) and store its
+ * length in *len, or return NULL on failure.
+ */
+static /*@null@*/void *limits_compile (FILE *fil, size_t *len)
 {
-	FILE *fil;
 	char buf[1024];
 	char name[1024];
-	char limits[1024];
-	char deflimits[1024];
 	char tempbuf[1024];
+	struct cache_buf lines = { NULL, 0, 0 };
+	struct cache_buf strings = { NULL, 0, 0 };
+	struct limits_entry *entries = NULL;
+	uint32_t *buckets = NULL;
+	struct limits_db hdr;
+	uint32_t nlines = 0;
+	uint32_t line = 0;
+	uint32_t i;
+	char *db = NULL;
+	const char *cp;
+
+	memzero (&hdr, sizeof hdr);
+
+	/* First, collect the valid lines (see setup_user_limits) */
+	while (fgets (buf, 1024, fil) != NULL) {
+		line++;
+		if (('#' == buf[0]) || ('\n' == buf[0])) {
+			continue;
+		}
+		memzero (tempbuf, sizeof (tempbuf));
+		if (sscanf (buf, "%s%[ACDFIKLMNOPRSTUacdfiklmnoprstu0-9 \t-]",
+		            name, tempbuf) != 2) {
+			continue;
+		}
+		if (   (cache_buf_add (&lines, &line, sizeof line) != 0)
+		    || (cache_buf_add (&lines, name, strlen (name) + 1) != 0)
+		    || (cache_buf_add (&lines, tempbuf, strlen (tempbuf) + 1) != 0)) {
+			goto fail;
+		}
+		nlines++;
+	}
+
+	hdr.nbuckets = 16;
+	while (hdr.nbuckets < 2 * nlines) {
+		hdr.nbuckets *= 2;
+	}
+	buckets = calloc (hdr.nbuckets, sizeof *buckets);
+	entries = calloc (nlines + 1, sizeof *entries);
+	if ((NULL == buckets) || (NULL == entries)) {
+		goto fail;
+	}
+
+	/* Then build the hash table */
+	for (cp = lines.data, i = 0; i < nlines; i++) {
+		uint32_t *b;
+		const char *lname, *llimits;
+		uint32_t lline;
+		struct limits_entry *e = NULL;
+
+		memcpy (&lline, cp, sizeof lline);
+		lname = cp + sizeof lline;
+		llimits = lname + strlen (lname) + 1;
+		cp = llimits + strlen (llimits) + 1;
+
+		b = &buckets[commonio_hash (lname) & (hdr.nbuckets - 1)];
+		for (e = (0 != *b) ? &entries[*b - 1] : NULL;
+		     NULL != e;
+		     e = (0 != e->next) ? &entries[e->next - 1] : NULL) {
+			if (strcmp (strings.data + e->name, lname) == 0) {
+				break;
+			}
+		}
+
+		if (NULL == e) {
+			e = &entries[hdr.nentries];
+			hdr.nentries++;
+			e->name = (uint32_t) strings.len;
+			if (cache_buf_add (&strings, lname, strlen (lname) + 1) != 0) {
+				goto fail;
+			}
+			e->next = *b;
+			*b = hdr.nentries;
+			if ('@' == lname[0]) {
+				hdr.ngroups++;
+			}
+		} else if (('@' != lname[0]) && ('*' != lname[0])) {
+			/* Only the first line of a user is considered */
+			continue;
+		}
 
-	/* init things */
-	memzero (buf, sizeof (buf));
-	memzero (name, sizeof (name));
-	memzero (limits, sizeof (limits));
-	memzero (deflimits, sizeof (deflimits));
-	memzero (tempbuf, sizeof (tempbuf));
+		/* The last line of a group or default is considered */
+		e->limits = (uint32_t) strings.len;
+		e->line = lline;
+		if (cache_buf_add (&strings, llimits, strlen (llimits) + 1) != 0) {
+			goto fail;
+		}
+	}
+	hdr.strings_len = (uint32_t) strings.len;
+
+	*len = sizeof hdr
+	       + hdr.nbuckets * sizeof *buckets
+	       + hdr.nentries * sizeof *entries
+	       + strings.len;
+	db = malloc (*len);
+	if (NULL != db) {
+		char *p = db;
+
+		memcpy (p, &hdr, sizeof hdr);
+		p += sizeof hdr;
+		memcpy (p, buckets, hdr.nbuckets * sizeof *buckets);
+		p += hdr.nbuckets * sizeof *buckets;
+		memcpy (p, entries, hdr.nentries * sizeof *entries);
+		p += hdr.nentries * sizeof *entries;
+		if (0 != strings.len) {
+			memcpy (p, strings.data, strings.len);
+		}
+	}
+
+      fail:
+	free (lines.data);
+	free (strings.data);
+	free (entries);
+	free (buckets);
+	return db;
+}
+
+static int limits_line_cmp (const void *p1, const void *p2)
+{
+	const struct limits_entry *const *e1 = p1;
+	const struct limits_entry *const *e2 = p2;
+
+	/* Last line first */
+	return ((*e1)->line < (*e2)->line) - ((*e1)->line > (*e2)->line);
+}
+
+/*
+ * Find the limits of the last @group line matching a group of the user.
+ *
+ * The user is in a group if it is listed as one of its members. The
+ * groups of the @group lines are checked from the last line, and the
+ * search stops at the first match.
+ */
+static /*@null@*/const struct limits_entry *limits_find_group (
+	const void *db,
+	size_t len,
+	const struct passwd *info)
+{
+	const struct limits_db *hdr = db;
+	const struct limits_entry *entries;
+	const struct limits_entry **groups;
+	const struct limits_entry *found = NULL;
+	const char *strings;
+	uint32_t ngroups = 0;
+	uint32_t i;
+
+	if (!limits_valid (db, len)) {
+		return NULL;
+	}
+	entries = (const struct limits_entry *)
+	          ((const uint32_t *) (hdr + 1) + hdr->nbuckets);
+	strings = (const char *) (entries + hdr->nentries);
+
+	groups = malloc (hdr->nentries * sizeof *groups);
+	if (NULL == groups) {
+		return NULL;
+	}
+	for (i = 0; i < hdr->nentries; i++) {
+		if (   (entries[i].name < hdr->strings_len)
+		    && ('@' == strings[entries[i].name])) {
+			groups[ngroups] = &entries[i];
+			ngroups++;
+		}
+	}
+	qsort (groups, ngroups, sizeof *groups, limits_line_cmp);
+
+	for (i = 0; (i < ngroups) && (NULL == found); i++) {
+		const char *gname = strings + groups[i]->name + 1;
+		struct group *grp;
+
+		/* We are not claiming to be re-entrant! */
+		grp = getgrnam (gname);
+		if (NULL == grp) {
+			SYSLOG ((LOG_WARN, "Nonexisting group `%s' in limits file.",
+			         gname));
+			continue;
+		}
+		if (is_on_list (grp->gr_mem, info->pw_name)) {
+			found = groups[i];
+		}
+	}
+
+	free (groups);
+	return found;
+}
+
+static int setup_user_limits (const struct passwd *info)
+{
+	FILE *fil;
+	struct stat sb;
+	const void *db;
+	void *compiled = NULL;
+	size_t len = 0;
+	const struct limits_entry *e;
+	char limits[1024];
 
 	/* start the checks */
 	fil = fopen (LIMITS_FILE, "r");
 	if (fil == NULL) {
 		return 0;
 	}
+	if (fstat (fileno (fil), &sb) != 0) {
+		(void) fclose (fil);
+		return 0;
+	}
+
+	db = cache_map (LIMITS_CACHE, LIMITS_MAGIC, &sb, &len);
+	if (NULL == db) {
+		compiled = limits_compile (fil, &len);
+		if (NULL == compiled) {
+			(void) fclose (fil);
+			return 0;
+		}
+		(void) cache_write (LIMITS_CACHE, LIMITS_MAGIC, &sb,
+		                    compiled, len);
+		db = compiled;
+	}
+	(void) fclose (fil);
+
 	/* The limits file have the following format:
 	 * - '#' (comment) chars only as first chars on a line;
 	 * - username must start on first column (or *, or @group)
 	 *
 	 * FIXME: A better (smarter) checking should be done
+	 *
+	 * a valid line should have a username, then spaces,
+	 * then limits
+	 * we allow the format:
+	 * username    L2  D2048  R4096
+	 * where spaces={' ',\t}. Also, we reject invalid limits.
+	 * Imposing a limit should be done with care, so a wrong
+	 * entry means no care anyway :-).
+	 *
+	 * A '-' as a limits strings means no limits
+	 *
+	 * The username can also be:
+	 *  '*': the default limits (only the last is taken into
+	 *       account)
+	 *  @group: the limit applies to the members of the group
+	 *
+	 * To clarify: The first entry with matching user name rules,
+	 * everything after it is ignored. If there is no user entry,
+	 * the last encountered entry for a matching group rules.
+	 * If there is no matching group entry, the default limits rule.
 	 */
-	while (fgets (buf, 1024, fil) != NULL) {
-		if (('#' == buf[0]) || ('\n' == buf[0])) {
-			continue;
-		}
-		memzero (tempbuf, sizeof (tempbuf));
-		/* a valid line should have a username, then spaces,
-		 * then limits
-		 * we allow the format:
-		 * username    L2  D2048  R4096
-		 * where spaces={' ',\t}. Also, we reject invalid limits.
-		 * Imposing a limit should be done with care, so a wrong
-		 * entry means no care anyway :-).
-		 *
-		 * A '-' as a limits strings means no limits
-		 *
-		 * The username can also be:
-		 *  '*': the default limits (only the last is taken into
-		 *       account)
-		 *  @group: the limit applies to the members of the group
-		 *
-		 * To clarify: The first entry with matching user name rules,
-		 * everything after it is ignored. If there is no user entry,
-		 * the last encountered entry for a matching group rules.
-		 * If there is no matching group entry, the default limits rule.
-		 */
-		if (sscanf (buf, "%s%[ACDFIKLMNOPRSTUacdfiklmnoprstu0-9 \t-]",
-		            name, tempbuf) == 2) {
-			if (strcmp (name, uname) == 0) {
-				strcpy (limits, tempbuf);
-				break;
-			} else if (strcmp (name, "*") == 0) {
-				strcpy (deflimits, tempbuf);
-			} else if (name[0] == '@') {
-				/* If the user is in the group, the group
-				 * limits apply unless later a line for
-				 * the specific user is found.
-				 */
-				if (user_in_group (uname, name+1)) {
-					strcpy (limits, tempbuf);
-				}
-			}
-		}
+	e = limits_find (db, len, info->pw_name);
+	if (   (NULL == e)
+	    && (len >= sizeof (struct limits_db))
+	    && (0 != ((const struct limits_db *) db)->ngroups)) {
+		e = limits_find_group (db, len, info);
 	}
-	(void) fclose (fil);
-	if (limits[0] == '\0') {
+	if (NULL == e) {
 		/* no user specific limits */
-		if (deflimits[0] == '\0') {	/* no default limits */
-			return 0;
-		}
-		strcpy (limits, deflimits);	/* use the default limits */
+		e = limits_find (db, len, "*");
+	}
+	limits[0] = '\0';
+	if (NULL != e) {
+		strncpy (limits, limits_string (db, e), sizeof limits - 1);
+		limits[sizeof limits - 1] = '\0';
+	}
+
+	if (NULL != compiled) {
+		free (compiled);
+	} else {
+		cache_unmap (db, len);
+	}
+
+	if (limits[0] == '\0') {	/* no limits */
+		return 0;
 	}
-	return do_user_limits (limits, uname);
+	return do_user_limits (limits, info->pw_name);
 }
 #endif				/* LIMITS */
 
@@ -547,7 +821,7 @@ void setup_limits (const struct passwd *info)
 	if (getdef_bool ("QUOTAS_ENAB")) {
 #ifdef LIMITS
 		if (info->pw_uid != 0) {
-			if ((setup_user_limits (info->pw_name) & LOGIN_ERROR_LOGIN) != 0) {
+			if ((setup_user_limits (info) & LOGIN_ERROR_LOGIN) != 0) {
 				(void) fputs (_("Too many logins.\n"), shadow_logfd);
 				(void) sleep (2); /* XXX: Should be FAIL_DELAY */
 				exit (EXIT_FAILURE);
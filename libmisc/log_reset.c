@@ -0,0 +1,246 @@
+#include <config.h>
+
+#ident "$Id$"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <lastlog.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "prototypes.h"
+#include "defines.h"
+#include "faillog.h"
+#include "getdef.h"
+
+/*
+ * Reset of the login records of new users
+ *
+ * When a user is created with the UID (or name) of a deleted user, the
+ * records of the deleted user in faillog, lastlog and in the logs of
+ * pam_tally2 (tallylog) and pam_faillock are reset.
+ *
+ * The records are written directly. The log files are opened at the
+ * first reset and kept open, so that a tool creating many users opens
+ * each log only once. They are synced and closed by log_reset_close().
+ */
+/*
+ * Needed for MkLinux DR1/2/2.1 - J.
+ */
+#ifndef LASTLOG_FILE
+#define LASTLOG_FILE "/var/log/lastlog"
+#endif
+#ifndef TALLYLOG_FILE
+#define TALLYLOG_FILE "/var/log/tallylog"
+#endif
+#ifndef FAILLOCK_DIR
+#define FAILLOCK_DIR "/var/run/faillock"
+#endif
+
+/* Format of the records of pam_tally2 */
+struct tallylog {
+	char fail_line[52];
+	uint16_t reserved;
+	uint16_t fail_cnt;
+	uint64_t fail_time;
+};
+
+struct log_file {
+	const char *path;
+	int fd;			/* -1: not open yet, -2: no such log */
+	uid_t uid;		/* last UID reset */
+};
+
+static struct log_file faillog = { FAILLOG_FILE, -1, 0 };
+static struct log_file lastlog = { LASTLOG_FILE, -1, 0 };
+static struct log_file tallylog = { TALLYLOG_FILE, -1, 0 };
+static /*@null@*/char *tallylog_user = NULL;	/* last user reset */
+
+/*
+ * Write the record of uid in log, opening log if needed. Logs which do
+ * not exist are ignored.
+ *
+ * Return 0 on success, -1 if the log could not be opened, -2 if the
+ * record could not be written (errno set).
+ */
+static int log_reset (struct log_file *log, uid_t uid,
+                      const void *record, size_t size)
+{
+	if (-2 == log->fd) {
+		return 0;
+	}
+	if (-1 == log->fd) {
+		if (access (log->path, F_OK) != 0) {
+			log->fd = -2;
+			return 0;
+		}
+		log->fd = open (log->path, O_RDWR | O_NOCTTY | O_CLOEXEC);
+		if (-1 == log->fd) {
+			int saved_errno = errno;
+			log->fd = -2;
+			errno = saved_errno;
+			return -1;
+		}
+	}
+
+	log->uid = uid;
+	if (pwrite (log->fd, record, size, (off_t) size * uid)
+	    != (ssize_t) size) {
+		return -2;
+	}
+	return 0;
+}
+
+/*
+ * Sync and close log.
+ *
+ * Return 0 on success, -1 on failure (errno set).
+ */
+static int log_close (struct log_file *log)
+{
+	int ret = 0;
+
+	if (log->fd >= 0) {
+		if ((fsync (log->fd) != 0) || (close (log->fd) != 0)) {
+			ret = -1;
+		}
+	}
+	log->fd = -1;
+	return ret;
+}
+
+/*
+ * faillog_reset - reset the faillog entry of uid
+ */
+void faillog_reset (uid_t uid)
+{
+	struct faillog fl;
+
+	memzero (&fl, sizeof (fl));
+
+	switch (log_reset (&faillog, uid, &fl, sizeof (fl))) {
+	case -1:
+		fprintf (stderr,
+		         _("%s: failed to open the faillog file for UID %lu: %s\n"),
+		         Prog, (unsigned long) uid, strerror (errno));
+		SYSLOG ((LOG_WARN, "failed to open the faillog file for UID %lu", (unsigned long) uid));
+		break;
+	case -2:
+		fprintf (stderr,
+		         _("%s: failed to reset the faillog entry of UID %lu: %s\n"),
+		         Prog, (unsigned long) uid, strerror (errno));
+		SYSLOG ((LOG_WARN, "failed to reset the faillog entry of UID %lu", (unsigned long) uid));
+		break;
+	default:
+		break;
+	}
+}
+
+/*
+ * lastlog_reset - reset the lastlog entry of uid
+ *
+ *	The UIDs above LASTLOG_UID_MAX are not in lastlog.
+ */
+void lastlog_reset (uid_t uid)
+{
+	struct lastlog ll;
+	uid_t max_uid;
+
+	max_uid = (uid_t) getdef_ulong ("LASTLOG_UID_MAX", 0xFFFFFFFFUL);
+	if (uid > max_uid) {
+		/* do not touch lastlog for large uids */
+		return;
+	}
+
+	memzero (&ll, sizeof (ll));
+
+	switch (log_reset (&lastlog, uid, &ll, sizeof (ll))) {
+	case -1:
+		fprintf (stderr,
+		         _("%s: failed to open the lastlog file for UID %lu: %s\n"),
+		         Prog, (unsigned long) uid, strerror (errno));
+		SYSLOG ((LOG_WARN, "failed to open the lastlog file for UID %lu", (unsigned long) uid));
+		break;
+	case -2:
+		fprintf (stderr,
+		         _("%s: failed to reset the lastlog entry of UID %lu: %s\n"),
+		         Prog, (unsigned long) uid, strerror (errno));
+		SYSLOG ((LOG_WARN, "failed to reset the lastlog entry of UID %lu", (unsigned long) uid));
+		break;
+	default:
+		break;
+	}
+}
+
+static void tallylog_failed (const char *user_name)
+{
+	fprintf (stderr,
+	         _("%s: failed to reset the tallylog entry of user \"%s\"\n"),
+	         Prog, user_name);
+	SYSLOG ((LOG_WARN, "failed to reset the tallylog entry of user \"%s\"", user_name));
+}
+
+/*
+ * tallylog_reset - reset the pam_tally2 and pam_faillock records of a
+ *                  user
+ *
+ *	The tallylog of pam_tally2 is indexed by UID. pam_faillock keeps
+ *	one file per user name, which is truncated.
+ */
+void tallylog_reset (uid_t uid, const char *user_name)
+{
+	struct tallylog tl;
+	char path[1024];
+	int fd;
+
+	memzero (&tl, sizeof (tl));
+
+	if (log_reset (&tallylog, uid, &tl, sizeof (tl)) != 0) {
+		tallylog_failed (user_name);
+	}
+	if (-2 != tallylog.fd) {
+		free (tallylog_user);
+		tallylog_user = xstrdup (user_name);
+	}
+
+	if (   (strchr (user_name, '/') != NULL)
+	    || (snprintf (path, sizeof path, "%s/%s", FAILLOCK_DIR, user_name)
+	        >= (int) sizeof path)) {
+		return;
+	}
+	fd = open (path, O_WRONLY | O_NOCTTY | O_NOFOLLOW | O_CLOEXEC);
+	if (-1 == fd) {
+		return;
+	}
+	if (ftruncate (fd, 0) != 0) {
+		tallylog_failed (user_name);
+	}
+	(void) close (fd);
+}
+
+/*
+ * log_reset_close - sync and close the logs opened by the resets
+ */
+void log_reset_close (void)
+{
+	if (log_close (&faillog) != 0) {
+		fprintf (stderr,
+		         _("%s: failed to close the faillog file for UID %lu: %s\n"),
+		         Prog, (unsigned long) faillog.uid, strerror (errno));
+		SYSLOG ((LOG_WARN, "failed to close the faillog file for UID %lu", (unsigned long) faillog.uid));
+	}
+	if (log_close (&lastlog) != 0) {
+		fprintf (stderr,
+		         _("%s: failed to close the lastlog file for UID %lu: %s\n"),
+		         Prog, (unsigned long) lastlog.uid, strerror (errno));
+		SYSLOG ((LOG_WARN, "failed to close the lastlog file for UID %lu", (unsigned long) lastlog.uid));
+	}
+	if ((log_close (&tallylog) != 0) && (NULL != tallylog_user)) {
+		tallylog_failed (tallylog_user);
+	}
+	free (tallylog_user);
+	tallylog_user = NULL;
+}
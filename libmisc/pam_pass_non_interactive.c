@@ -162,6 +162,100 @@ int do_pam_passwd_non_interactive (const char *pam_service,
 
 	return ((PAM_SUCCESS == ret) ? 0 : 1);
 }
+
+/*
+ * The PAM handle kept by do_pam_passwd_non_interactive_batch() for the
+ * next users of the same service.
+ */
+/*@null@*/static pam_handle_t *batch_pamh = NULL;
+/*@null@*/ /*@only@*/static char *batch_service = NULL;
+
+/*
+ * End the PAM transaction kept by do_pam_passwd_non_interactive_batch().
+ */
+void end_pam_passwd_non_interactive (void)
+{
+	if (NULL != batch_pamh) {
+		(void) pam_end (batch_pamh, PAM_SUCCESS);
+		batch_pamh = NULL;
+	}
+	free (batch_service);
+	batch_service = NULL;
+}
+
+/*
+ * Change non interactively the user's password using PAM, like
+ * do_pam_passwd_non_interactive(), but keep the PAM handle for the next
+ * calls with the same service, so that the modules of the service are
+ * only loaded once for a batch of users. Only PAM_USER is changed from
+ * one user to the next.
+ *
+ * The handle is dropped after a failure, so that the next user starts
+ * with a fresh transaction.
+ *
+ * end_pam_passwd_non_interactive() shall be called after the last user.
+ *
+ * Return 0 on success, 1 on failure.
+ */
+int do_pam_passwd_non_interactive_batch (const char *pam_service,
+                                         const char *username,
+                                         const char* password)
+{
+	int ret;
+
+	if (   (NULL != batch_pamh)
+	    && (strcmp (batch_service, pam_service) != 0)) {
+		end_pam_passwd_non_interactive ();
+	}
+
+	if (NULL == batch_pamh) {
+		batch_service = strdup (pam_service);
+		if (NULL == batch_service) {
+			fprintf (shadow_logfd,
+			         _("%s: out of memory\n"), Prog);
+			return 1;
+		}
+		ret = pam_start (pam_service, username,
+		                 &non_interactive_pam_conv, &batch_pamh);
+		if (ret != PAM_SUCCESS) {
+			fprintf (shadow_logfd,
+			         _("%s: (user %s) pam_start failure %d\n"),
+			         Prog, username, ret);
+			batch_pamh = NULL;
+			end_pam_passwd_non_interactive ();
+			return 1;
+		}
+	} else {
+		/*
+		 * Switch to the new user. The authentication tokens
+		 * cannot be set by an application; the modules clear
+		 * them at the end of pam_chauthtok().
+		 */
+		ret = pam_set_item (batch_pamh, PAM_USER, username);
+		if (ret != PAM_SUCCESS) {
+			fprintf (shadow_logfd,
+			         _("%s: (user %s) pam_set_item() failed, error:\n"
+			           "%s\n"),
+			         Prog, username, pam_strerror (batch_pamh, ret));
+			end_pam_passwd_non_interactive ();
+			return 1;
+		}
+	}
+
+	non_interactive_password = password;
+	ret = pam_chauthtok (batch_pamh, 0);
+	non_interactive_password = NULL;
+	if (ret != PAM_SUCCESS) {
+		fprintf (shadow_logfd,
+		         _("%s: (user %s) pam_chauthtok() failed, error:\n"
+		           "%s\n"),
+		         Prog, username, pam_strerror (batch_pamh, ret));
+		end_pam_passwd_non_interactive ();
+		return 1;
+	}
+
+	return 0;
+}
 #else				/* !USE_PAM */
 extern int errno;		/* warning: ANSI C forbids an empty source file */
 #endif				/* !USE_PAM */
@@ -185,8 +185,15 @@ extern struct group *prefix_getgrnam(const char *name)
 		fclose(fg);
 		return grp;
 	}
+	else {
+		struct group *grp;
+		struct instr_mark mark;
 
-	return getgrnam(name);
+		instr_begin (&mark, "nss");
+		grp = getgrnam (name);
+		instr_end (&mark);
+		return grp;
+	}
 }
 
 extern struct group *prefix_getgrgid(gid_t gid)
@@ -205,8 +212,15 @@ extern struct group *prefix_getgrgid(gid_t gid)
 		fclose(fg);
 		return grp;
 	}
+	else {
+		struct group *grp;
+		struct instr_mark mark;
 
-	return getgrgid(gid);
+		instr_begin (&mark, "nss");
+		grp = getgrgid (gid);
+		instr_end (&mark);
+		return grp;
+	}
 }
 
 extern struct passwd *prefix_getpwuid(uid_t uid)
@@ -226,7 +240,13 @@ extern struct passwd *prefix_getpwuid(uid_t uid)
 		return pwd;
 	}
 	else {
-		return getpwuid(uid);
+		struct passwd *pwd;
+		struct instr_mark mark;
+
+		instr_begin (&mark, "nss");
+		pwd = getpwuid (uid);
+		instr_end (&mark);
+		return pwd;
 	}
 }
 extern struct passwd *prefix_getpwnam(const char* name)
@@ -246,7 +266,13 @@ extern struct passwd *prefix_getpwnam(const char* name)
 		return pwd;
 	}
 	else {
-		return getpwnam(name);
+		struct passwd *pwd;
+		struct instr_mark mark;
+
+		instr_begin (&mark, "nss");
+		pwd = getpwnam (name);
+		instr_end (&mark);
+		return pwd;
 	}
 }
 extern struct spwd *prefix_getspnam(const char* name)
@@ -266,7 +292,13 @@ extern struct spwd *prefix_getspnam(const char* name)
 		return sp;
 	}
 	else {
-		return getspnam(name);
+		struct spwd *sp;
+		struct instr_mark mark;
+
+		instr_begin (&mark, "nss");
+		sp = getspnam (name);
+		instr_end (&mark);
+		return sp;
 	}
 }
 
@@ -44,15 +44,7 @@
 #include "prototypes.h"
 #include "defines.h"
 
-/*
- * remove_tree - delete a directory tree
- *
- *	remove_tree() walks a directory tree and deletes all the files
- *	and directories.
- *	At the end, it deletes the root directory itself.
- */
-
-int remove_tree (const char *root, bool remove_root)
+static int do_remove_tree (const char *root, bool remove_root)
 {
 	char *new_name = NULL;
 	int err = 0;
@@ -103,7 +95,7 @@ int remove_tree (const char *root, bool remove_root)
 			/*
 			 * Recursively delete this directory.
 			 */
-			if (remove_tree (new_name, true) != 0) {
+			if (do_remove_tree (new_name, true) != 0) {
 				err = -1;
 				break;
 			}
@@ -131,3 +123,22 @@ int remove_tree (const char *root, bool remove_root)
 	return err;
 }
 
+/*
+ * remove_tree - delete a directory tree
+ *
+ *	remove_tree() walks a directory tree and deletes all the files
+ *	and directories.
+ *	At the end, it deletes the root directory itself.
+ */
+
+int remove_tree (const char *root, bool remove_root)
+{
+	struct instr_mark mark;
+	int err;
+
+	instr_begin (&mark, "remove_tree");
+	err = do_remove_tree (root, remove_root);
+	instr_end (&mark);
+	return err;
+}
+
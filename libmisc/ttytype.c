@@ -38,17 +38,35 @@
 #include "prototypes.h"
 #include "defines.h"
 #include "getdef.h"
+/*
+ * Each line of the tty types file gives a terminal type and a port.
+ */
+static bool ttytype_parse (char *line, const char **name, const char **value)
+{
+	char *type, *port;
+
+	if (line[0] == '#') {
+		return false;
+	}
+	type = strtok (line, " \t\n\r\f\v");
+	port = strtok (NULL, " \t\n\r\f\v");
+	if (NULL == port) {
+		return false;
+	}
+	*name = port;
+	*value = type;
+	return true;
+}
+
 /*
  * ttytype - set ttytype from port to terminal type mapping database
  */
 void ttytype (const char *line)
 {
 	FILE *fp;
-	char buf[BUFSIZ];
 	const char *typefile;
-	char *cp;
-	char type[1024] = "";
-	char port[1024];
+	const char *type;
+	struct nametable *table;
 
 	if (getenv ("TERM") != NULL) {
 		return;
@@ -66,25 +84,16 @@ void ttytype (const char *line)
 		perror (typefile);
 		return;
 	}
-	while (fgets (buf, (int) sizeof buf, fp) == buf) {
-		if (buf[0] == '#') {
-			continue;
-		}
-
-		cp = strchr (buf, '\n');
-		if (NULL != cp) {
-			*cp = '\0';
-		}
-
-		if (   (sscanf (buf, "%1023s %1023s", type, port) == 2)
-		    && (strcmp (line, port) == 0)) {
-			break;
-		}
+	table = nametable_load (fp, "ttytype", ttytype_parse);
+	(void) fclose (fp);
+	if (NULL == table) {
+		return;
 	}
-	if ((feof (fp) == 0) && (ferror (fp) == 0) && (type[0] != '\0')) {
+
+	type = nametable_find (table, line);
+	if ((NULL != type) && (type[0] != '\0')) {
 		addenv ("TERM", type);
 	}
 
-	(void) fclose (fp);
+	nametable_free (table);
 }
-
@@ -39,6 +39,7 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <unistd.h>
 #include "defines.h"
 #include "prototypes.h"
@@ -47,7 +48,6 @@
 #endif				/* ENABLE_SUBIDS */
 
 #ifdef __linux__
-static int check_status (const char *name, const char *sname, uid_t uid);
 static int user_busy_processes (const char *name, uid_t uid);
 #else				/* !__linux__ */
 static int user_busy_utmp (const char *name);
@@ -107,112 +107,210 @@ static int user_busy_utmp (const char *name)
 #endif				/* !__linux__ */
 
 #ifdef __linux__
+/*
+ * State of a scan of /proc for the processes of a user.
+ */
+struct busy_scan {
+	const char *name;
+	uid_t uid;
+	int procfd;		/* /proc */
+	struct stat sbroot;	/* our root directory */
+#ifdef ENABLE_SUBIDS
+	char ns[512];		/* our user namespace */
+	ssize_t ns_len;		/* -1 if unknown */
+	/*@null@*/struct subid_index *subuids;
+	bool subuids_loaded;
+#endif				/* ENABLE_SUBIDS */
+};
+
 #ifdef ENABLE_SUBIDS
-#define in_parentuid_range(uid) ((uid) >= parentuid && (uid) < parentuid + range)
-static int different_namespace (const char *sname)
+/*
+ * different_namespace - check if the process or task at path (relative
+ * to /proc) is in another user namespace.
+ */
+static bool different_namespace (const struct busy_scan *scan,
+                                 int dirfd, const char *path)
 {
-	/* 41: /proc/xxxxxxxxxx/task/xxxxxxxxxx/ns/user + \0 */
-	char path[41];
-	char buf[512], buf2[512];
-	ssize_t llen1, llen2;
+	char ns_path[NAME_MAX + sizeof "/ns/user"];
+	char buf[512];
+	ssize_t len;
 
-	snprintf (path, 41, "/proc/%s/ns/user", sname);
+	if (-1 == scan->ns_len) {
+		return false;
+	}
 
-	if ((llen1 = readlink (path, buf, sizeof(buf))) == -1)
-		return 0;
+	(void) snprintf (ns_path, sizeof ns_path, "%s/ns/user", path);
+	len = readlinkat (dirfd, ns_path, buf, sizeof buf);
+	if (-1 == len) {
+		return false;
+	}
 
-	if ((llen2 = readlink ("/proc/self/ns/user", buf2, sizeof(buf2))) == -1)
-		return 0;
+	return (len != scan->ns_len) || (memcmp (buf, scan->ns, len) != 0);
+}
 
-	if (llen1 == llen2 && memcmp (buf, buf2, llen1) == 0)
-		return 0; /* same namespace */
+/*
+ * have_sub_uid - check if uid is a subordinate UID of the user
+ *
+ * The subordinate UIDs of the user are only indexed when the first
+ * process in another user namespace is found.
+ */
+static bool have_sub_uid (struct busy_scan *scan, unsigned long uid)
+{
+	if (!scan->subuids_loaded) {
+		int opened;
 
-	return 1;
-}
-#endif                          /* ENABLE_SUBIDS */
+		scan->subuids_loaded = true;
+		/* There may be no subuid file with an NSS module */
+		opened = sub_uid_open (O_RDONLY);
+		scan->subuids = sub_uid_index (scan->name);
+		if (0 != opened) {
+			(void) sub_uid_close ();
+		}
+	}
 
+	return (NULL != scan->subuids) && subid_index_has (scan->subuids, uid);
+}
+#endif				/* ENABLE_SUBIDS */
 
-static int check_status (const char *name, const char *sname, uid_t uid)
+/*
+ * check_status - check if the process or task at path (relative to
+ * dirfd) is running as the user, or as one of its subordinate UIDs in
+ * another user namespace.
+ */
+static int check_status (struct busy_scan *scan, int dirfd, const char *path)
 {
-	/* 40: /proc/xxxxxxxxxx/task/xxxxxxxxxx/status + \0 */
-	char status[40];
-	char line[1024];
-	FILE *sfile;
+	char status_path[NAME_MAX + sizeof "/status"];
+	/* The Uid: line is in the first lines of the status file */
+	char buf[4096];
+	const char *line;
+	unsigned long ruid, euid, suid;
+	ssize_t len;
+	int fd;
 
-	snprintf (status, 40, "/proc/%s/status", sname);
+	(void) snprintf (status_path, sizeof status_path, "%s/status", path);
+	fd = openat (dirfd, status_path, O_RDONLY | O_CLOEXEC);
+	if (-1 == fd) {
+		return 0;
+	}
+	len = pread (fd, buf, sizeof buf - 1, 0);
+	(void) close (fd);
+	if (len <= 0) {
+		return 0;
+	}
+	buf[len] = '\0';
 
-	sfile = fopen (status, "r");
-	if (NULL == sfile) {
+	line = strstr (buf, "\nUid:\t");
+	if (NULL == line) {
 		return 0;
 	}
-	while (fgets (line, sizeof (line), sfile) == line) {
-		if (strncmp (line, "Uid:\t", 5) == 0) {
-			unsigned long ruid, euid, suid;
-
-			assert (uid == (unsigned long) uid);
-			(void) fclose (sfile);
-			if (sscanf (line,
-			            "Uid:\t%lu\t%lu\t%lu\n",
-			            &ruid, &euid, &suid) == 3) {
-				if (   (ruid == (unsigned long) uid)
-				    || (euid == (unsigned long) uid)
-				    || (suid == (unsigned long) uid) ) {
-					return 1;
-				}
+	if (sscanf (line + 1, "Uid:\t%lu\t%lu\t%lu\n",
+	            &ruid, &euid, &suid) != 3) {
+		/* Ignore errors. This is just a best effort. */
+		return 0;
+	}
+
+	assert (scan->uid == (unsigned long) scan->uid);
+	if (   (ruid == (unsigned long) scan->uid)
+	    || (euid == (unsigned long) scan->uid)
+	    || (suid == (unsigned long) scan->uid) ) {
+		return 1;
+	}
 #ifdef ENABLE_SUBIDS
-				if (    different_namespace (sname)
-				     && (   have_sub_uids(name, ruid, 1)
-				         || have_sub_uids(name, euid, 1)
-				         || have_sub_uids(name, suid, 1))
-				   ) {
-					return 1;
-				}
+	if (    different_namespace (scan, dirfd, path)
+	     && (   have_sub_uid (scan, ruid)
+	         || have_sub_uid (scan, euid)
+	         || have_sub_uid (scan, suid))
+	   ) {
+		return 1;
+	}
 #endif				/* ENABLE_SUBIDS */
-			} else {
-				/* Ignore errors. This is just a best effort. */
-			}
-			return 0;
+	return 0;
+}
+
+/*
+ * check_process - check the process pid and its tasks
+ */
+static int check_process (struct busy_scan *scan, const char *spid, pid_t pid)
+{
+	char path[NAME_MAX + sizeof "/task"];	/* or /root */
+	struct stat sbroot_process;
+	struct dirent *ent;
+	DIR *task_dir;
+	int taskfd;
+	int ret = 0;
+
+	/* Check if the process is in our chroot */
+	(void) snprintf (path, sizeof path, "%s/root", spid);
+	if (fstatat (scan->procfd, path, &sbroot_process, 0) != 0) {
+		return 0;
+	}
+	if (   (scan->sbroot.st_dev != sbroot_process.st_dev)
+	    || (scan->sbroot.st_ino != sbroot_process.st_ino)) {
+		return 0;
+	}
+
+	if (check_status (scan, scan->procfd, spid) != 0) {
+		return 1;
+	}
+
+	(void) snprintf (path, sizeof path, "%s/task", spid);
+	taskfd = openat (scan->procfd, path,
+	                 O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (-1 == taskfd) {
+		/* Ignore errors. This is just a best effort */
+		return 0;
+	}
+	task_dir = fdopendir (taskfd);
+	if (NULL == task_dir) {
+		(void) close (taskfd);
+		return 0;
+	}
+	while ((0 == ret) && ((ent = readdir (task_dir)) != NULL)) {
+		pid_t tid;
+
+		if (get_pid (ent->d_name, &tid) == 0) {
+			continue;
+		}
+		if (tid == pid) {
+			continue;
 		}
+		ret = check_status (scan, taskfd, ent->d_name);
 	}
-	(void) fclose (sfile);
-	return 0;
+	(void) closedir (task_dir);
+
+	return ret;
 }
 
 static int user_busy_processes (const char *name, uid_t uid)
 {
+	struct busy_scan scan;
 	DIR *proc;
 	struct dirent *ent;
 	char *tmp_d_name;
 	pid_t pid;
-	DIR *task_dir;
-	/* 22: /proc/xxxxxxxxxx/task + \0 */
-	char task_path[22];
-	char root_path[22];
-	struct stat sbroot;
-	struct stat sbroot_process;
+	int ret = 0;
 
-#ifdef ENABLE_SUBIDS
-	sub_uid_open (O_RDONLY);
-#endif				/* ENABLE_SUBIDS */
+	memzero (&scan, sizeof scan);
+	scan.name = name;
+	scan.uid = uid;
 
 	proc = opendir ("/proc");
 	if (proc == NULL) {
 		perror ("opendir /proc");
-#ifdef ENABLE_SUBIDS
-		sub_uid_close();
-#endif
 		return 0;
 	}
-	if (stat ("/", &sbroot) != 0) {
+	/* The entries of /proc are opened relative to its descriptor */
+	scan.procfd = dirfd (proc);
+	if (stat ("/", &scan.sbroot) != 0) {
 		perror ("stat (\"/\")");
 		(void) closedir (proc);
-#ifdef ENABLE_SUBIDS
-		sub_uid_close();
-#endif
 		return 0;
 	}
+#ifdef ENABLE_SUBIDS
+	scan.ns_len = readlink ("/proc/self/ns/user", scan.ns, sizeof scan.ns);
+#endif				/* ENABLE_SUBIDS */
 
-	while ((ent = readdir (proc)) != NULL) {
+	while ((0 == ret) && ((ent = readdir (proc)) != NULL)) {
 		tmp_d_name = ent->d_name;
 		/*
 		 * Ingo Molnar's patch introducing NPTL for 2.4 hides
@@ -233,63 +331,21 @@ static int user_busy_processes (const char *name, uid_t uid)
 			continue;
 		}
 
-		/* Check if the process is in our chroot */
-		snprintf (root_path, 22, "/proc/%lu/root", (unsigned long) pid);
-		root_path[21] = '\0';
-		if (stat (root_path, &sbroot_process) != 0) {
-			continue;
-		}
-		if (   (sbroot.st_dev != sbroot_process.st_dev)
-		    || (sbroot.st_ino != sbroot_process.st_ino)) {
-			continue;
-		}
-
-		if (check_status (name, tmp_d_name, uid) != 0) {
-			(void) closedir (proc);
-#ifdef ENABLE_SUBIDS
-			sub_uid_close();
-#endif
-			fprintf (shadow_logfd,
-			         _("%s: user %s is currently used by process %d\n"),
-			         Prog, name, pid);
-			return 1;
-		}
-
-		snprintf (task_path, 22, "/proc/%lu/task", (unsigned long) pid);
-		task_path[21] = '\0';
-		task_dir = opendir (task_path);
-		if (task_dir != NULL) {
-			while ((ent = readdir (task_dir)) != NULL) {
-				pid_t tid;
-				if (get_pid (ent->d_name, &tid) == 0) {
-					continue;
-				}
-				if (tid == pid) {
-					continue;
-				}
-				if (check_status (name, task_path+6, uid) != 0) {
-					(void) closedir (proc);
-					(void) closedir (task_dir);
-#ifdef ENABLE_SUBIDS
-					sub_uid_close();
-#endif
-					fprintf (shadow_logfd,
-					         _("%s: user %s is currently used by process %d\n"),
-					         Prog, name, pid);
-					return 1;
-				}
-			}
-			(void) closedir (task_dir);
-		} else {
-			/* Ignore errors. This is just a best effort */
-		}
+		ret = check_process (&scan, tmp_d_name, pid);
 	}
 
 	(void) closedir (proc);
 #ifdef ENABLE_SUBIDS
-	sub_uid_close();
+	if (NULL != scan.subuids) {
+		subid_index_free (scan.subuids);
+	}
 #endif				/* ENABLE_SUBIDS */
-	return 0;
+
+	if (0 != ret) {
+		fprintf (shadow_logfd,
+		         _("%s: user %s is currently used by process %d\n"),
+		         Prog, name, pid);
+	}
+	return ret;
 }
 #endif				/* __linux__ */
-
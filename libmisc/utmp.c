@@ -42,8 +42,12 @@
 #endif
 
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <netdb.h>
 #include <stdio.h>
 
@@ -83,6 +87,239 @@ static bool is_my_tty (const char *tty)
 	}
 }
 
+#if !defined(USE_UTMPX) && defined(HAVE_STRUCT_UTMP_UT_ID) \
+ && defined(HAVE_STRUCT_UTMP_UT_TYPE)
+#define UTMP_INDEX
+#endif
+
+#ifdef UTMP_INDEX
+/*
+ * Indexed access to the utmp file
+ *
+ * getutent() and pututline() read the utmp file one entry at a time, so
+ * that finding the entry of the current session, and then updating it,
+ * costs two scans of the file. With many sessions, this is slow.
+ *
+ * The slot of the entry of each line is remembered in a small table
+ * (UTMP_SLOTS in CACHE_DIR, indexed by a hash of the line), and the
+ * entry at this slot is checked first. The file is only scanned (with
+ * large reads) if the slot is stale. The slot found by
+ * get_current_utmp() is kept for setutmp(), which then rewrites this
+ * slot directly if it still holds the entry of the session.
+ *
+ * The file is locked like the libc does. If it cannot be locked at
+ * once, getutent() and pututline() are used.
+ */
+#ifdef _PATH_UTMP
+#define UTMP_PATH	_PATH_UTMP	/* the file of getutent() */
+#else
+#define UTMP_PATH	_UTMP_FILE
+#endif
+#define UTMP_SLOTS	"utmp-slots"
+#define UTMP_NSLOTS	4096
+
+/* slot of the entry returned by get_current_utmp(), or -1 */
+static off_t current_slot = -1;
+
+static bool utmp_lock (int fd, short type)
+{
+	struct flock lk;
+
+	memzero (&lk, sizeof lk);
+	lk.l_type = type;
+	lk.l_whence = SEEK_SET;
+	return (fcntl (fd, F_SETLK, &lk) == 0);
+}
+
+/*
+ * Get the slot remembered for line, or -1.
+ */
+static off_t utmp_slot_get (const char *line)
+{
+	char path[1024];
+	struct stat sb;
+	uint32_t slot;
+	int fd;
+
+	(void) snprintf (path, sizeof path, "%s/%s", CACHE_DIR, UTMP_SLOTS);
+	fd = open (path, O_RDONLY | O_NOCTTY | O_NOFOLLOW | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	if (   (fstat (fd, &sb) != 0)
+	    || !S_ISREG (sb.st_mode)
+	    || ((0 != sb.st_uid) && (geteuid () != sb.st_uid))
+	    || ((sb.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+	    || (pread (fd, &slot, sizeof slot,
+	               (off_t) ((commonio_hash (line) % UTMP_NSLOTS)
+	                        * sizeof slot)) != (ssize_t) sizeof slot)) {
+		slot = 0;
+	}
+	(void) close (fd);
+	return (0 != slot) ? (off_t) slot - 1 : -1;
+}
+
+/*
+ * Remember the slot of the entry of line. Only root updates the table.
+ */
+static void utmp_slot_set (const char *line, off_t slot)
+{
+	char path[1024];
+	uint32_t value = (uint32_t) slot + 1;
+	int fd;
+
+	if ((0 != geteuid ()) || (slot >= (off_t) UINT32_MAX)) {
+		return;
+	}
+	if (cache_mkdir () != 0) {
+		return;
+	}
+	(void) snprintf (path, sizeof path, "%s/%s", CACHE_DIR, UTMP_SLOTS);
+	fd = open (path, O_WRONLY | O_CREAT | O_NOCTTY | O_NOFOLLOW | O_CLOEXEC,
+	           0644);
+	if (fd < 0) {
+		return;
+	}
+	(void) pwrite (fd, &value, sizeof value,
+	               (off_t) ((commonio_hash (line) % UTMP_NSLOTS)
+	                        * sizeof value));
+	(void) close (fd);
+}
+#endif				/* UTMP_INDEX */
+
+#ifndef USE_UTMPX
+/*
+ * Tell if ut is the entry of the current session.
+ */
+static bool utmp_is_current (const struct utmp *ut)
+{
+	return (   (ut->ut_pid == getpid ())
+#ifdef HAVE_STRUCT_UTMP_UT_ID
+	        && ('\0' != ut->ut_id[0])
+#endif
+#ifdef HAVE_STRUCT_UTMP_UT_TYPE
+	        && (   (LOGIN_PROCESS == ut->ut_type)
+	            || (USER_PROCESS  == ut->ut_type))
+#endif
+	        /* A process may have failed to close an entry
+	         * Check if this entry refers to the current tty */
+	        && is_my_tty (ut->ut_line));
+}
+#endif				/* !USE_UTMPX */
+
+#ifdef UTMP_INDEX
+/*
+ * Find the entry of the current session in the utmp file, at the slot
+ * remembered for the current tty or by reading the whole file.
+ *
+ * Return its slot and copy it in *found, or return -1 if there is no
+ * such entry, or -2 if the file could not be read.
+ */
+static off_t utmp_find_current (/*@out@*/struct utmp *found)
+{
+	struct utmp buf[64];
+	const char *line;
+	off_t slot = -1;
+	off_t n;
+	ssize_t len;
+	int fd;
+
+	fd = open (UTMP_PATH, O_RDONLY | O_NOCTTY | O_CLOEXEC);
+	if (fd < 0) {
+		return -2;
+	}
+	if (!utmp_lock (fd, F_RDLCK)) {
+		(void) close (fd);
+		return -2;
+	}
+
+	line = ttyname (STDIN_FILENO);
+	if ((NULL != line) && (strncmp (line, "/dev/", 5) == 0)) {
+		line += 5;
+		slot = utmp_slot_get (line);
+	} else {
+		line = NULL;
+	}
+	if (   (-1 != slot)
+	    && (pread (fd, found, sizeof *found,
+	               slot * (off_t) sizeof *found) == (ssize_t) sizeof *found)
+	    && utmp_is_current (found)) {
+		(void) utmp_lock (fd, F_UNLCK);
+		(void) close (fd);
+		return slot;
+	}
+
+	slot = -1;
+	for (n = 0;;) {
+		size_t i;
+
+		len = pread (fd, buf, sizeof buf, n * (off_t) sizeof buf[0]);
+		if (len < (ssize_t) sizeof buf[0]) {
+			break;
+		}
+		for (i = 0; i < (size_t) len / sizeof buf[0]; i++) {
+			if (utmp_is_current (&buf[i])) {
+				*found = buf[i];
+				slot = n + (off_t) i;
+				break;
+			}
+		}
+		if (-1 != slot) {
+			break;
+		}
+		n += (off_t) ((size_t) len / sizeof buf[0]);
+	}
+	(void) utmp_lock (fd, F_UNLCK);
+	(void) close (fd);
+
+	if (len < 0) {
+		return -2;
+	}
+	if ((-1 != slot) && (NULL != line)) {
+		utmp_slot_set (line, slot);
+	}
+	return slot;
+}
+
+/*
+ * Rewrite the entry of the current session at the slot found by
+ * get_current_utmp(), if it is still there.
+ *
+ * Return 0 on success, -1 if pututline() shall be used.
+ */
+static int utmp_write_current (const struct utmp *ut)
+{
+	struct utmp old;
+	int ret = -1;
+	int fd;
+
+	if (-1 == current_slot) {
+		return -1;
+	}
+	fd = open (UTMP_PATH, O_RDWR | O_NOCTTY | O_CLOEXEC);
+	if (fd < 0) {
+		return -1;
+	}
+	if (!utmp_lock (fd, F_WRLCK)) {
+		(void) close (fd);
+		return -1;
+	}
+	if (   (pread (fd, &old, sizeof old,
+	               current_slot * (off_t) sizeof old) == (ssize_t) sizeof old)
+	    && (old.ut_pid == getpid ())
+	    && (   (LOGIN_PROCESS == old.ut_type)
+	        || (USER_PROCESS  == old.ut_type))
+	    && (strncmp (old.ut_id, ut->ut_id, sizeof old.ut_id) == 0)
+	    && (pwrite (fd, ut, sizeof *ut,
+	                current_slot * (off_t) sizeof *ut) == (ssize_t) sizeof *ut)) {
+		ret = 0;
+	}
+	(void) utmp_lock (fd, F_UNLCK);
+	(void) close (fd);
+	return ret;
+}
+#endif				/* UTMP_INDEX */
+
 /*
  * get_current_utmp - return the most probable utmp entry for the current
  *                    session
@@ -103,21 +340,28 @@ static bool is_my_tty (const char *tty)
 	struct utmp *ut;
 	struct utmp *ret = NULL;
 
+#ifdef UTMP_INDEX
+	{
+		struct utmp found;
+
+		current_slot = utmp_find_current (&found);
+		if (current_slot >= 0) {
+			ret = (struct utmp *) xmalloc (sizeof (*ret));
+			memcpy (ret, &found, sizeof (*ret));
+			return ret;
+		}
+		if (-1 == current_slot) {
+			return NULL;
+		}
+		current_slot = -1;
+	}
+#endif				/* UTMP_INDEX */
+
 	setutent ();
 
 	/* First, try to find a valid utmp entry for this process.  */
 	while ((ut = getutent ()) != NULL) {
-		if (   (ut->ut_pid == getpid ())
-#ifdef HAVE_STRUCT_UTMP_UT_ID
-		    && ('\0' != ut->ut_id[0])
-#endif
-#ifdef HAVE_STRUCT_UTMP_UT_TYPE
-		    && (   (LOGIN_PROCESS == ut->ut_type)
-		        || (USER_PROCESS  == ut->ut_type))
-#endif
-		    /* A process may have failed to close an entry
-		     * Check if this entry refers to the current tty */
-		    && is_my_tty (ut->ut_line)) {
+		if (utmp_is_current (ut)) {
 			break;
 		}
 	}
@@ -343,11 +587,16 @@ int setutmp (struct utmp *ut)
 
 	assert (NULL != ut);
 
-	setutent ();
-	if (pututline (ut) == NULL) {
-		err = 1;
+#ifdef UTMP_INDEX
+	if (utmp_write_current (ut) != 0)
+#endif				/* UTMP_INDEX */
+	{
+		setutent ();
+		if (pututline (ut) == NULL) {
+			err = 1;
+		}
+		endutent ();
 	}
-	endutent ();
 
 #ifndef USE_PAM
 	/* This is done by pam_lastlog */
@@ -71,6 +71,7 @@
 	char *buffer=NULL;
 	/* we have to start with something */
 	size_t length = 0x100;
+	struct instr_mark mark;
 
 	result = malloc(sizeof(LOOKUP_TYPE));
 	if (NULL == result) {
@@ -89,8 +90,10 @@
 			exit (13);
 		}
 		errno = 0;
+		instr_begin (&mark, "nss");
 		status = REENTRANT_NAME(ARG_NAME, result, buffer,
 		                        length, &resbuf);
+		instr_end (&mark);
 		if ((0 == status) && (resbuf == result)) {
 			/* Build a result structure that can be freed by
 			 * the shadow *_free functions. */
@@ -127,7 +130,12 @@
 	 * We should also restore the initial structure. But that would be
 	 * overkill.
 	 */
-	LOOKUP_TYPE *result = FUNCTION_NAME(ARG_NAME);
+	struct instr_mark mark;
+	LOOKUP_TYPE *result;
+
+	instr_begin (&mark, "nss");
+	result = FUNCTION_NAME(ARG_NAME);
+	instr_end (&mark);
 
 	if (result) {
 		result = DUP_FUNCTION(result);
@@ -34,6 +34,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pwd.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include "subordinateio.h"
 #include "idmapping.h"
@@ -64,10 +65,115 @@ bool libsubid_init(const char *progname, FILE * logfd)
 	return true;
 }
 
+/*
+ * A session keeps a snapshot of /etc/subuid and /etc/subgid, which are
+ * only reloaded when they change.
+ */
+struct subid_handle {
+	struct subid_snapshot *snap[2];	/* indexed by id_type - 1 */
+};
+
+/*
+ * The session used by the one-shot functions.  It is opened on first use,
+ * and again on the next call if that failed.
+ */
+static struct subid_handle *default_handle;
+static pthread_mutex_t default_handle_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * grant and ungrant go through the commonio databases, whose state is
+ * global.
+ */
+static pthread_mutex_t grant_lock = PTHREAD_MUTEX_INITIALIZER;
+
+struct subid_handle *subid_open(void)
+{
+	struct subid_handle *h;
+
+	h = calloc(1, sizeof(*h));
+	if (!h)
+		return NULL;
+	h->snap[ID_TYPE_UID - 1] = subid_snapshot_new(sub_uid_dbname(), ID_TYPE_UID);
+	h->snap[ID_TYPE_GID - 1] = subid_snapshot_new(sub_gid_dbname(), ID_TYPE_GID);
+	if (!h->snap[ID_TYPE_UID - 1] || !h->snap[ID_TYPE_GID - 1]) {
+		subid_close(h);
+		return NULL;
+	}
+	return h;
+}
+
+void subid_close(struct subid_handle *h)
+{
+	if (!h)
+		return;
+	if (h->snap[ID_TYPE_UID - 1])
+		subid_snapshot_free(h->snap[ID_TYPE_UID - 1]);
+	if (h->snap[ID_TYPE_GID - 1])
+		subid_snapshot_free(h->snap[ID_TYPE_GID - 1]);
+	free(h);
+}
+
+int subid_get_ranges(struct subid_handle *h, const char *owner, enum subid_type id_type, struct subid_range **ranges)
+{
+	*ranges = NULL;
+	if (id_type != ID_TYPE_UID && id_type != ID_TYPE_GID)
+		return -1;
+	return subid_snapshot_ranges(h->snap[id_type - 1], owner, ranges);
+}
+
+int subid_get_owners(struct subid_handle *h, unsigned long id, enum subid_type id_type, uid_t **owners)
+{
+	*owners = NULL;
+	if (id_type != ID_TYPE_UID && id_type != ID_TYPE_GID)
+		return -1;
+	return subid_snapshot_owners(h->snap[id_type - 1], id, owners);
+}
+
+int subid_get_ranges_batch(struct subid_handle *h, const char *const *owners, size_t n, enum subid_type id_type, struct subordinate_range **ranges)
+{
+	*ranges = NULL;
+	if (id_type != ID_TYPE_UID && id_type != ID_TYPE_GID)
+		return -1;
+	return subid_snapshot_ranges_batch(h->snap[id_type - 1], owners, n, ranges);
+}
+
+int subid_get_owners_batch(struct subid_handle *h, const unsigned long *ids, size_t n, enum subid_type id_type, struct subid_owner **owners)
+{
+	*owners = NULL;
+	if (id_type != ID_TYPE_UID && id_type != ID_TYPE_GID)
+		return -1;
+	return subid_snapshot_owners_batch(h->snap[id_type - 1], ids, n, owners);
+}
+
+int subid_list_all_ranges(struct subid_handle *h, enum subid_type id_type, struct subordinate_range **ranges)
+{
+	*ranges = NULL;
+	if (id_type != ID_TYPE_UID && id_type != ID_TYPE_GID)
+		return -1;
+	return subid_snapshot_all_ranges(h->snap[id_type - 1], ranges);
+}
+
+static struct subid_handle *get_default_handle(void)
+{
+	struct subid_handle *h;
+
+	pthread_mutex_lock(&default_handle_lock);
+	if (!default_handle)
+		default_handle = subid_open();
+	h = default_handle;
+	pthread_mutex_unlock(&default_handle_lock);
+	return h;
+}
+
 static
 int get_subid_ranges(const char *owner, enum subid_type id_type, struct subid_range **ranges)
 {
-	return list_owner_ranges(owner, id_type, ranges);
+	struct subid_handle *h = get_default_handle();
+
+	*ranges = NULL;
+	if (!h)
+		return -1;
+	return subid_get_ranges(h, owner, id_type, ranges);
 }
 
 int get_subuid_ranges(const char *owner, struct subid_range **ranges)
@@ -83,7 +189,12 @@ int get_subgid_ranges(const char *owner, struct subid_range **ranges)
 static
 int get_subid_owner(unsigned long id, enum subid_type id_type, uid_t **owner)
 {
-	return find_subid_owners(id, id_type, owner);
+	struct subid_handle *h = get_default_handle();
+
+	*owner = NULL;
+	if (!h)
+		return -1;
+	return subid_get_owners(h, id, id_type, owner);
 }
 
 int get_subuid_owners(uid_t uid, uid_t **owner)
@@ -100,7 +211,12 @@ static
 bool grant_subid_range(struct subordinate_range *range, bool reuse,
 		       enum subid_type id_type)
 {
-	return new_subid_range(range, id_type, reuse);
+	bool ret;
+
+	pthread_mutex_lock(&grant_lock);
+	ret = new_subid_range(range, id_type, reuse);
+	pthread_mutex_unlock(&grant_lock);
+	return ret;
 }
 
 bool grant_subuid_range(struct subordinate_range *range, bool reuse)
@@ -116,7 +232,12 @@ bool grant_subgid_range(struct subordinate_range *range, bool reuse)
 static
 bool ungrant_subid_range(struct subordinate_range *range, enum subid_type id_type)
 {
-	return release_subid_range(range, id_type);
+	bool ret;
+
+	pthread_mutex_lock(&grant_lock);
+	ret = release_subid_range(range, id_type);
+	pthread_mutex_unlock(&grant_lock);
+	return ret;
 }
 
 bool ungrant_subuid_range(struct subordinate_range *range)
@@ -19,6 +19,12 @@ struct subordinate_range {
 	unsigned long count;
 };
 
+/* subid_owner is a subordinate ID and one of the users it is delegated to */
+struct subid_owner {
+	unsigned long id;
+	uid_t owner;
+};
+
 enum subid_type {
 	ID_TYPE_UID = 1,
 	ID_TYPE_GID = 2
@@ -41,12 +47,113 @@ enum subid_status {
  *            default if libsubid_init() is not called is stderr (2).
  *
  * This function does not need to be called.  If not called, then the defaults
- * will be used.
+ * will be used.  In a multithreaded program, it must be called before the
+ * other threads use libsubid.
  *
  * Returns false if an error occurred.
  */
 bool libsubid_init(const char *progname, FILE *logfd);
 
+/*
+ * struct subid_handle: a session on the subordinate ID databases
+ *
+ * The databases are loaded on the first query, and then only reloaded
+ * when they are modified, so that many queries can be done without
+ * rereading the files. The one-shot functions below share a session.
+ *
+ * The queries are thread-safe: several threads can query a session at the
+ * same time, they are only serialized while a database is reloaded.
+ */
+struct subid_handle;
+
+/*
+ * subid_open: open a session
+ *
+ * Returns NULL if an error occurred.
+ */
+struct subid_handle *subid_open(void);
+
+/*
+ * subid_close: close a session opened with subid_open()
+ */
+void subid_close(struct subid_handle *h);
+
+/*
+ * subid_get_ranges: return a list of subordinate ID ranges for a user
+ *
+ * @h: session
+ * @owner: username being queried
+ * @id_type: subuid or subgid
+ * @ranges: a pointer to an array of subid_range structs in which the result
+ *          will be returned.
+ *
+ * The caller must free(ranges) when done.
+ *
+ * returns: number of ranges found, or < 0 on error.
+ */
+int subid_get_ranges(struct subid_handle *h, const char *owner, enum subid_type id_type, struct subid_range **ranges);
+
+/*
+ * subid_get_owners: return a list of uids to which the given subordinate ID
+ *                   has been delegated.
+ *
+ * @h: session
+ * @id: the subordinate ID being queried
+ * @id_type: subuid or subgid
+ * @owners: a pointer to an array of uids into which the results are placed.
+ *          The returned array must be freed by the caller.
+ *
+ * Returns the number of uids returned, or < 0 on error.
+ */
+int subid_get_owners(struct subid_handle *h, unsigned long id, enum subid_type id_type, uid_t **owners);
+
+/*
+ * subid_get_ranges_batch: return the subordinate ID ranges of several users
+ *
+ * @h: session
+ * @owners: array of @n usernames being queried
+ * @id_type: subuid or subgid
+ * @ranges: a pointer to an array of subordinate_range structs in which the
+ *          result will be returned. The ranges are in the order of @owners,
+ *          and their ->owner points to the string of @owners.
+ *
+ * The caller must free(ranges) when done.
+ *
+ * returns: number of ranges found, or < 0 on error.
+ */
+int subid_get_ranges_batch(struct subid_handle *h, const char *const *owners, size_t n, enum subid_type id_type, struct subordinate_range **ranges);
+
+/*
+ * subid_get_owners_batch: return the uids to which several subordinate IDs
+ *                         have been delegated.
+ *
+ * @h: session
+ * @ids: array of @n subordinate IDs being queried
+ * @id_type: subuid or subgid
+ * @owners: a pointer to an array of (id, uid) pairs, in the order of @ids,
+ *          into which the results are placed. The returned array must be
+ *          freed by the caller.
+ *
+ * Returns the number of pairs returned, or < 0 on error.
+ */
+int subid_get_owners_batch(struct subid_handle *h, const unsigned long *ids, size_t n, enum subid_type id_type, struct subid_owner **owners);
+
+/*
+ * subid_list_all_ranges: return all the subordinate ID ranges
+ *
+ * @h: session
+ * @id_type: subuid or subgid
+ * @ranges: a pointer to an array of subordinate_range structs in which the
+ *          result will be returned.
+ *
+ * The owners are stored in the same allocation as the array: the caller
+ * must only free(ranges) when done. With a subid NSS module, this fails
+ * unless the module can enumerate its ranges.
+ *
+ * returns: number of ranges found, or < 0 on error.
+ */
+int subid_list_all_ranges(struct subid_handle *h, enum subid_type id_type, struct subordinate_range **ranges);
+
 /*
  * get_subuid_ranges: return a list of UID ranges for a user
  *
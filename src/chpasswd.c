@@ -516,7 +516,8 @@ int main (int argc, char **argv)
 
 #ifdef USE_PAM
 		if (use_pam) {
-			if (do_pam_passwd_non_interactive ("chpasswd", name, newpwd) != 0) {
+			if (do_pam_passwd_non_interactive_batch ("chpasswd",
+			                                         name, newpwd) != 0) {
 				fprintf (stderr,
 				         _("%s: (line %d, user %s) password not changed\n"),
 				         Prog, line, name);
@@ -660,6 +661,12 @@ int main (int argc, char **argv)
 		}
 	}
 
+#ifdef USE_PAM
+	if (use_pam) {
+		end_pam_passwd_non_interactive ();
+	}
+#endif				/* USE_PAM */
+
 	/*
 	 * Any detected errors will cause the entire set of changes to be
 	 * aborted. Unlocking the password file will cause all of the
@@ -212,15 +212,37 @@ static void grp_update (void)
 
 	if (user_list) {
 		char *token;
+		struct memberset *members;
+
+		members = memberset_new (grp.gr_mem);
+		if (NULL == members) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, gr_dbname ());
+			exit (E_GRP_UPDATE);
+		}
 		token = strtok(user_list, ",");
 		while (token) {
 			if (prefix_getpwnam (token) == NULL) {
 				fprintf (stderr, _("Invalid member username %s\n"), token);
 				exit (E_GRP_UPDATE);
 			}
-			grp.gr_mem = add_list(grp.gr_mem, token);
+			if (memberset_add (members, token) == -1) {
+				fprintf (stderr,
+				         _("%s: Out of memory. Cannot update %s.\n"),
+				         Prog, gr_dbname ());
+				exit (E_GRP_UPDATE);
+			}
 			token = strtok(NULL, ",");
 		}
+		grp.gr_mem = memberset_list (members);
+		memberset_free (members);
+		if (NULL == grp.gr_mem) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, gr_dbname ());
+			exit (E_GRP_UPDATE);
+		}
 	}
 
 	/*
@@ -264,17 +264,20 @@ static void grp_update (void)
 
 	if (user_list) {
 		char *token;
+		struct memberset *members;
 
 		if (!aflg) {
 			// requested to replace the existing groups
-			if (NULL != grp.gr_mem[0])
-				gr_free_members(&grp);
-			grp.gr_mem = (char **)xmalloc(sizeof(char *));
-			grp.gr_mem[0] = (char *)0;
+			members = memberset_new (NULL);
 		} else {
 			// append to existing groups
-			if (NULL != grp.gr_mem[0])
-				grp.gr_mem = dup_list (grp.gr_mem);
+			members = memberset_new (grp.gr_mem);
+		}
+		if (NULL == members) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, gr_dbname ());
+			exit (E_GRP_UPDATE);
 		}
 
 		token = strtok(user_list, ",");
@@ -283,9 +286,23 @@ static void grp_update (void)
 				fprintf (stderr, _("Invalid member username %s\n"), token);
 				exit (E_GRP_UPDATE);
 			}
-			grp.gr_mem = add_list(grp.gr_mem, token);
+			if (memberset_add (members, token) == -1) {
+				fprintf (stderr,
+				         _("%s: Out of memory. Cannot update %s.\n"),
+				         Prog, gr_dbname ());
+				exit (E_GRP_UPDATE);
+			}
 			token = strtok(NULL, ",");
 		}
+
+		grp.gr_mem = memberset_list (members);
+		memberset_free (members);
+		if (NULL == grp.gr_mem) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, gr_dbname ());
+			exit (E_GRP_UPDATE);
+		}
 	}
 
 	/*
@@ -884,7 +884,8 @@ int main (int argc, char **argv)
 
 	/* Open the PAM session */
 	get_pam_user (&pam_user);
-	retcode = pam_open_session (pamh, hushed (pam_user) ? PAM_SILENT : 0);
+	retcode = pam_open_session (pamh,
+	                             hushed (pam_user, NULL) ? PAM_SILENT : 0);
 	PAM_FAIL_CHECK;
 
 	/* Grab the user information out of the password file for future usage
@@ -1294,7 +1295,7 @@ int main (int argc, char **argv)
 	(void) bindtextdomain (PACKAGE, LOCALEDIR);
 	(void) textdomain (PACKAGE);
 
-	if (!hushed (username)) {
+	if (!hushed (username, pwd)) {
 		addenv ("HUSHLOGIN=FALSE", NULL);
 		/*
 		 * pam_unix, pam_mail and pam_lastlog should take care of
@@ -33,13 +33,23 @@
 
 #ident "$Id$"
 
+#include <assert.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <signal.h>
 #include <stdio.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/wait.h>
+#ifdef HAVE_PATHS_H
+#include <paths.h>
+#endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
 #include "defines.h"
 #include "prototypes.h"
+#include "port.h"
 /*
  * Global variables
  */
@@ -54,41 +64,245 @@ FILE *shadow_logfd = NULL;
 #define HUP_MESG_FILE "/etc/logoutd.mesg"
 #endif
 
-/* local function prototypes */
+#ifndef _PATH_UTMP
+#define _PATH_UTMP "/var/run/utmp"
+#endif
+
 #ifdef USE_UTMPX
-static int check_login (const struct utmpx *ut);
+#define UT_SIZE(field) (sizeof (((struct utmpx *) NULL)->field))
 #else				/* !USE_UTMPX */
-static int check_login (const struct utmp *ut);
+#define UT_SIZE(field) (sizeof (((struct utmp *) NULL)->field))
 #endif				/* !USE_UTMPX */
+
+/*
+ * The longest time logoutd sleeps. Without inotify, the utmpx/utmp file
+ * is scanned at this interval.
+ */
+#ifdef HAVE_SYS_INOTIFY_H
+#define MAX_SLEEP	3600
+#else
+#define MAX_SLEEP	60
+#endif
+
+/*
+ * The login sessions found in the utmpx/utmp file, with the times of the
+ * entry of /etc/porttime which applies to them, and the next time they
+ * shall be checked ((time_t) -1 if the entry never changes its mind).
+ */
+struct session {
+	char user[UT_SIZE (ut_user) + 1];	/* terminating NUL */
+	char line[UT_SIZE (ut_line) + 1];
+	pid_t pid;
+	/*@null@*/ /*@dependent@*/const struct pt_time *times;
+	time_t next;
+	bool seen;
+};
+
+static /*@null@*/ /*@only@*/struct session *sessions = NULL;
+static size_t nsessions = 0;
+static size_t asessions = 0;
+
+#ifdef HAVE_SYS_INOTIFY_H
+static int watch_fd = -1;
+static int utmp_wd = -1;
+static int ports_wd = -1;
+#endif				/* HAVE_SYS_INOTIFY_H */
+
+/*
+ * Written to by the SIGCHLD handler, so that the children started by
+ * logout_session() are reaped when they exit.
+ */
+static int child_pipe[2] = { -1, -1 };
+
+/* local function prototypes */
+static /*@null@*/struct session *find_session (const char *line, pid_t pid,
+                                               size_t *hint);
+static void scan_utmp (void);
+static void logout_session (const struct session *s);
 static void send_mesg_to_tty (int tty_fd);
+#ifdef HAVE_SYS_INOTIFY_H
+static void add_watches (void);
+#endif				/* HAVE_SYS_INOTIFY_H */
+static RETSIGTYPE catch_child (int sig);
+static void watch_children (void);
+static bool wait_events (time_t timeout);
 
 /*
- * check_login - check if user (struct utmpx/utmp) allowed to stay logged in
+ * find_session - find a session by line and process
+ *
+ *	The sessions are kept in the order of the utmpx/utmp file, so the
+ *	search starts after the session found last (*hint).
  */
+static /*@null@*/struct session *find_session (const char *line, pid_t pid,
+                                               size_t *hint)
+{
+	size_t i;
+
+	for (i = 0; i < nsessions; i++) {
+		size_t j = (*hint + i) % nsessions;
+
+		if (   (sessions[j].pid == pid)
+		    && (strcmp (sessions[j].line, line) == 0)) {
+			*hint = j + 1;
+			return &sessions[j];
+		}
+	}
+	return NULL;
+}
+
+/*
+ * scan_utmp - update the sessions from the utmpx/utmp file
+ *
+ *	New sessions are checked at the next pass, sessions which are no
+ *	longer in the file are forgotten.
+ */
+static void scan_utmp (void)
+{
 #ifdef USE_UTMPX
-static int check_login (const struct utmpx *ut)
+	struct utmpx *ut;
 #else				/* !USE_UTMPX */
-static int check_login (const struct utmp *ut)
+	struct utmp *ut;
 #endif				/* !USE_UTMPX */
-{
-	char user[sizeof (ut->ut_user) + 1];
-	time_t now;
+	char user[UT_SIZE (ut_user) + 1];
+	char line[UT_SIZE (ut_line) + 1];
+	size_t hint = 0;
+	size_t i, j;
+
+	for (i = 0; i < nsessions; i++) {
+		sessions[i].seen = false;
+	}
 
 	/*
-	 * ut_user may not have the terminating NUL.
+	 * Attempt to re-open the utmpx/utmp file. The file is only
+	 * open while it is being used.
 	 */
-	strncpy (user, ut->ut_user, sizeof (ut->ut_user));
-	user[sizeof (ut->ut_user)] = '\0';
-
-	(void) time (&now);
+#ifdef USE_UTMPX
+	setutxent ();
+#else				/* !USE_UTMPX */
+	setutent ();
+#endif				/* !USE_UTMPX */
 
 	/*
-	 * Check if they are allowed to be logged in right now.
+	 * Read all of the entries in the utmpx/utmp file. The entries
+	 * for login sessions will be checked to see if the user
+	 * is permitted to be signed on at this time.
 	 */
-	if (!isttytime (user, ut->ut_line, now)) {
-		return 0;
+#ifdef USE_UTMPX
+	while ((ut = getutxent ()) != NULL)
+#else				/* !USE_UTMPX */
+	while ((ut = getutent ()) != NULL)
+#endif				/* !USE_UTMPX */
+	{
+		struct session *s;
+
+		if (ut->ut_type != USER_PROCESS) {
+			continue;
+		}
+		if (ut->ut_user[0] == '\0') {
+			continue;
+		}
+
+		/*
+		 * ut_user and ut_line may not have the terminating NUL.
+		 */
+		strncpy (user, ut->ut_user, sizeof (ut->ut_user));
+		user[sizeof (ut->ut_user)] = '\0';
+		strncpy (line, ut->ut_line, sizeof (ut->ut_line));
+		line[sizeof (ut->ut_line)] = '\0';
+
+		s = find_session (line, ut->ut_pid, &hint);
+		if (NULL == s) {
+			if (nsessions == asessions) {
+				struct session *tmp;
+				size_t n = (0 != asessions) ? asessions * 2 : 64;
+
+				tmp = realloc (sessions, n * sizeof (*sessions));
+				if (NULL == tmp) {
+					/* check it at the next scan */
+					continue;
+				}
+				sessions = tmp;
+				asessions = n;
+			}
+			s = &sessions[nsessions];
+			nsessions++;
+			strcpy (s->line, line);
+			s->pid = ut->ut_pid;
+			s->user[0] = '\0';
+		}
+		if (strcmp (s->user, user) != 0) {
+			strcpy (s->user, user);
+			s->times = port_rule (s->user, s->line);
+			s->next = (NULL != s->times) ? 0 : (time_t) -1;
+		}
+		s->seen = true;
+	}
+
+#ifdef USE_UTMPX
+	endutxent ();
+#else				/* !USE_UTMPX */
+	endutent ();
+#endif				/* !USE_UTMPX */
+
+	for (i = 0, j = 0; i < nsessions; i++) {
+		if (sessions[i].seen) {
+			sessions[j] = sessions[i];
+			j++;
+		}
 	}
-	return 1;
+	nsessions = j;
+}
+
+/*
+ * logout_session - log a user off
+ *
+ *	This is done in a child process, which keeps logoutd from waiting
+ *	on other ports to die.
+ */
+static void logout_session (const struct session *s)
+{
+	char tty_name[sizeof (s->line) + 5];	/* /dev/ */
+	int tty_fd;
+	pid_t pid;
+
+	pid = fork ();
+	if (0 != pid) {
+		/* parent, or failed - give up until the next check */
+		return;
+	}
+	/* child */
+
+	if (strncmp (s->line, "/dev/", 5) != 0) {
+		strcpy (tty_name, "/dev/");
+	} else {
+		tty_name[0] = '\0';
+	}
+
+	strcat (tty_name, s->line);
+#ifndef O_NOCTTY
+#define O_NOCTTY 0
+#endif
+	tty_fd = open (tty_name, O_WRONLY | O_NDELAY | O_NOCTTY);
+	if (tty_fd != -1) {
+		send_mesg_to_tty (tty_fd);
+		close (tty_fd);
+		sleep (10);
+	}
+
+	if (s->pid > 1) {
+		kill (-s->pid, SIGHUP);
+		sleep (10);
+		kill (-s->pid, SIGKILL);
+	}
+
+	SYSLOG ((LOG_NOTICE,
+		 "logged off user '%s' on '%s'", s->user,
+		 tty_name));
+
+	/*
+	 * This child has done all it can, drop dead.
+	 */
+	exit (EXIT_SUCCESS);
 }
 
 
@@ -134,28 +348,192 @@ static void send_mesg_to_tty (int tty_fd)
 }
 
 
+#ifdef HAVE_SYS_INOTIFY_H
+/*
+ * add_watches - watch the utmpx/utmp file and the directory of
+ *               /etc/porttime
+ *
+ *	The watches are added again if the files were replaced.
+ */
+static void add_watches (void)
+{
+	if (-1 == watch_fd) {
+		watch_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+		if (-1 == watch_fd) {
+			return;
+		}
+	}
+	if (-1 == utmp_wd) {
+		utmp_wd = inotify_add_watch (watch_fd, _PATH_UTMP,
+		                             IN_MODIFY | IN_ATTRIB
+		                             | IN_MOVE_SELF | IN_DELETE_SELF);
+	}
+	if (-1 == ports_wd) {
+		char dir[sizeof PORTS];
+		char *cp;
+
+		strcpy (dir, PORTS);
+		cp = strrchr (dir, '/');
+		if (NULL != cp) {
+			*cp = '\0';
+			ports_wd = inotify_add_watch (watch_fd, dir,
+			                              IN_CLOSE_WRITE | IN_ATTRIB
+			                              | IN_CREATE | IN_DELETE
+			                              | IN_MOVED_FROM | IN_MOVED_TO);
+		}
+	}
+}
+#endif				/* HAVE_SYS_INOTIFY_H */
+
+/*
+ * catch_child - wake up the main loop when a child exited
+ */
+static RETSIGTYPE catch_child (unused int sig)
+{
+	int saved_errno = errno;
+
+	(void) write (child_pipe[1], "", 1);
+	errno = saved_errno;
+}
+
+/*
+ * watch_children - catch SIGCHLD
+ *
+ *	If this fails, the children are reaped at least once per minute.
+ */
+static void watch_children (void)
+{
+	struct sigaction sa;
+
+	if (   (pipe (child_pipe) != 0)
+	    || (fcntl (child_pipe[0], F_SETFL, O_NONBLOCK) != 0)
+	    || (fcntl (child_pipe[1], F_SETFL, O_NONBLOCK) != 0)) {
+		return;
+	}
+
+	memzero (&sa, sizeof sa);
+	sa.sa_handler = catch_child;
+	sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+	(void) sigemptyset (&sa.sa_mask);
+	if (sigaction (SIGCHLD, &sa, NULL) != 0) {
+		(void) close (child_pipe[0]);
+		(void) close (child_pipe[1]);
+		child_pipe[0] = -1;
+		child_pipe[1] = -1;
+	}
+}
+
+/*
+ * wait_events - wait until timeout seconds elapsed, until the
+ *               utmpx/utmp file or /etc/porttime changed, or until a
+ *               child exited
+ *
+ *	Return true if the utmpx/utmp file shall be scanned again.
+ */
+static bool wait_events (time_t timeout)
+{
+	char buf[4096]
+#ifdef HAVE_SYS_INOTIFY_H
+		__attribute__ ((aligned (__alignof__ (struct inotify_event))))
+#endif				/* HAVE_SYS_INOTIFY_H */
+		;
+	struct pollfd pfd[2];
+	nfds_t nfds = 0;
+	bool changed = false;
+#ifdef HAVE_SYS_INOTIFY_H
+	ssize_t len;
+#endif				/* HAVE_SYS_INOTIFY_H */
+
+	if ((-1 == child_pipe[0]) && (timeout > 60)) {
+		/* Reap the children at least once per minute */
+		timeout = 60;
+	}
+
+#ifdef HAVE_SYS_INOTIFY_H
+	add_watches ();
+	if ((-1 == utmp_wd) || (-1 == ports_wd)) {
+		/* Not watched: scan at least once per minute */
+		if (timeout > 60) {
+			timeout = 60;
+		}
+		changed = true;
+	}
+	if (-1 != watch_fd) {
+		pfd[nfds].fd = watch_fd;
+		pfd[nfds].events = POLLIN;
+		nfds++;
+	}
+#else				/* !HAVE_SYS_INOTIFY_H */
+	changed = true;
+#endif				/* !HAVE_SYS_INOTIFY_H */
+	if (-1 != child_pipe[0]) {
+		pfd[nfds].fd = child_pipe[0];
+		pfd[nfds].events = POLLIN;
+		nfds++;
+	}
+	if (0 == nfds) {
+		(void) sleep ((unsigned int) timeout);
+		return true;
+	}
+
+	if (poll (pfd, nfds, (int) timeout * 1000) <= 0) {
+		return changed;
+	}
+
+	if (-1 != child_pipe[0]) {
+		while (read (child_pipe[0], buf, sizeof buf) > 0);
+	}
+
+#ifdef HAVE_SYS_INOTIFY_H
+	if (-1 == watch_fd) {
+		return true;
+	}
+
+	while ((len = read (watch_fd, buf, sizeof buf)) > 0) {
+		char *cp;
+
+		for (cp = buf; cp < buf + len;) {
+			const struct inotify_event *ev =
+				(const struct inotify_event *) cp;
+
+			if (ev->wd == utmp_wd) {
+				changed = true;
+				if ((ev->mask & IN_IGNORED) != 0) {
+					utmp_wd = -1;
+				}
+			} else if (   (ev->wd == ports_wd)
+			           && ((ev->mask & IN_IGNORED) != 0)) {
+				ports_wd = -1;
+			}
+			/*
+			 * The changes of /etc/porttime are found by
+			 * port_reload().
+			 */
+			cp += sizeof (*ev) + ev->len;
+		}
+	}
+#endif				/* HAVE_SYS_INOTIFY_H */
+	return changed;
+}
+
 /*
  * logoutd - logout daemon to enforce /etc/porttime file policy
  *
  *	logoutd is started at system boot time and enforces the login
  *	time and port restrictions specified in /etc/porttime. The
- *	utmpx/utmp file is periodically scanned and offending users are logged
- *	off from the system.
+ *	utmpx/utmp file is scanned when it changes, and offending users
+ *	are logged off from the system.
+ *
+ *	The entries of /etc/porttime are loaded once (and again when the
+ *	file changes), and each session is only checked again when its
+ *	entry may change its mind.
  */
 int main (int argc, char **argv)
 {
 	int i;
 	int status;
 	pid_t pid;
-
-#ifdef USE_UTMPX
-	struct utmpx *ut;
-#else				/* !USE_UTMPX */
-	struct utmp *ut;
-#endif				/* !USE_UTMPX */
-	char user[sizeof (ut->ut_user) + 1];	/* terminating NUL */
-	char tty_name[sizeof (ut->ut_line) + 6];	/* /dev/ + NUL */
-	int tty_fd;
+	bool rescan = true;
 
 	if (1 != argc) {
 		(void) fputs (_("Usage: logoutd\n"), stderr);
@@ -192,108 +570,64 @@ int main (int argc, char **argv)
 
 	OPENLOG ("logoutd");
 
-	/*
-	 * Scan the utmpx/utmp file once per minute looking for users that
-	 * are not supposed to still be logged in.
-	 */
-	while (true) {
+	watch_children ();
 
-		/*
-		 * Attempt to re-open the utmpx/utmp file. The file is only
-		 * open while it is being used.
-		 */
-#ifdef USE_UTMPX
-		setutxent ();
-#else				/* !USE_UTMPX */
-		setutent ();
-#endif				/* !USE_UTMPX */
+	while (true) {
+		time_t now;
+		time_t next = (time_t) -1;
+		size_t s;
+
+		if (port_reload ()) {
+			for (s = 0; s < nsessions; s++) {
+				sessions[s].times = port_rule (sessions[s].user,
+				                               sessions[s].line);
+				sessions[s].next = (NULL != sessions[s].times)
+				                 ? 0 : (time_t) -1;
+			}
+		}
+		if (rescan) {
+			scan_utmp ();
+		}
 
 		/*
-		 * Read all of the entries in the utmpx/utmp file. The entries
-		 * for login sessions will be checked to see if the user
-		 * is permitted to be signed on at this time.
+		 * Check the sessions which are due, and find when the
+		 * next one shall be checked.
 		 */
-#ifdef USE_UTMPX
-		while ((ut = getutxent ()) != NULL)
-#else				/* !USE_UTMPX */
-		while ((ut = getutent ()) != NULL)
-#endif				/* !USE_UTMPX */
-		{
-			if (ut->ut_type != USER_PROCESS) {
-				continue;
-			}
-			if (ut->ut_user[0] == '\0') {
-				continue;
-			}
-			if (check_login (ut)) {
-				continue;
-			}
+		(void) time (&now);
+		for (s = 0; s < nsessions; s++) {
+			struct session *sp = &sessions[s];
 
 			/*
-			 * Put the rest of this in a child process. This
-			 * keeps the scan from waiting on other ports to die.
+			 * port_next_change() is at most one hour ahead;
+			 * a later time means that the clock was set back.
 			 */
-
-			pid = fork ();
-			if (pid > 0) {
-				/* parent */
-				continue;
-			} else if (pid < 0) {
-				/* failed - give up until the next scan */
-				break;
-			}
-			/* child */
-
-			if (strncmp (ut->ut_line, "/dev/", 5) != 0) {
-				strcpy (tty_name, "/dev/");
-			} else {
-				tty_name[0] = '\0';
-			}
-
-			strcat (tty_name, ut->ut_line);
-#ifndef O_NOCTTY
-#define O_NOCTTY 0
-#endif
-			tty_fd =
-			    open (tty_name, O_WRONLY | O_NDELAY | O_NOCTTY);
-			if (tty_fd != -1) {
-				send_mesg_to_tty (tty_fd);
-				close (tty_fd);
-				sleep (10);
+			if (   ((time_t) -1 != sp->next)
+			    && ((sp->next <= now) || (sp->next - now > 3600))) {
+				assert (NULL != sp->times);
+				if (!port_allows (sp->times, now)) {
+					logout_session (sp);
+					/* Try again if they are still there */
+					sp->next = now + 60;
+				} else {
+					sp->next = port_next_change (sp->times,
+					                             now);
+				}
 			}
-
-			if (ut->ut_pid > 1) {
-				kill (-ut->ut_pid, SIGHUP);
-				sleep (10);
-				kill (-ut->ut_pid, SIGKILL);
+			if (   ((time_t) -1 != sp->next)
+			    && (((time_t) -1 == next) || (sp->next < next))) {
+				next = sp->next;
 			}
-
-			strncpy (user, ut->ut_user, sizeof (user) - 1);
-			user[sizeof (user) - 1] = '\0';
-
-			SYSLOG ((LOG_NOTICE,
-				 "logged off user '%s' on '%s'", user,
-				 tty_name));
-
-			/*
-			 * This child has done all it can, drop dead.
-			 */
-			exit (EXIT_SUCCESS);
 		}
 
-#ifdef USE_UTMPX
-		endutxent ();
-#else				/* !USE_UTMPX */
-		endutent ();
-#endif				/* !USE_UTMPX */
-
-#ifndef DEBUG
-		sleep (60);
-#endif
 		/*
 		 * Reap any dead babies ...
 		 */
-		while (wait (&status) != -1);
+		while (waitpid (-1, &status, WNOHANG) > 0);
+
+		if (((time_t) -1 == next) || (next - now > MAX_SLEEP)) {
+			next = now + MAX_SLEEP;
+		}
+		rescan = wait_events (next - now);
 	}
 
 	return EXIT_FAILURE;
@@ -49,14 +49,21 @@ const char *Prog;
 FILE *shadow_logfd = NULL;
 
 
-static bool verify_range(struct passwd *pw, struct map_range *range, bool *allow_setgroups)
+static bool verify_range(struct passwd *pw, struct subid_index *idx,
+	struct map_range *range, bool *allow_setgroups)
 {
+	bool allowed;
+
 	/* An empty range is invalid */
 	if (range->count == 0)
 		return false;
 
 	/* Test /etc/subgid. If the mapping is valid then we allow setgroups. */
-	if (have_sub_gids(pw->pw_name, range->lower, range->count)) {
+	if (NULL != idx)
+		allowed = subid_index_covers(idx, range->lower, range->count);
+	else
+		allowed = have_sub_gids(pw->pw_name, range->lower, range->count);
+	if (allowed) {
 		*allow_setgroups = true;
 		return true;
 	}
@@ -74,11 +81,19 @@ static void verify_ranges(struct passwd *pw, int ranges,
 	struct map_range *mappings, bool *allow_setgroups)
 {
 	struct map_range *mapping;
+	struct subid_index *subids;
 	int idx;
 
+	/*
+	 * Index the ranges of the caller once, rather than scanning the
+	 * database for each mapping. Without an index, the mappings are
+	 * checked one by one.
+	 */
+	subids = sub_gid_index(pw->pw_name);
+
 	mapping = mappings;
 	for (idx = 0; idx < ranges; idx++, mapping++) {
-		if (!verify_range(pw, mapping, allow_setgroups)) {
+		if (!verify_range(pw, subids, mapping, allow_setgroups)) {
 			fprintf(stderr, _( "%s: gid range [%lu-%lu) -> [%lu-%lu) not allowed\n"),
 				Prog,
 				mapping->upper,
@@ -88,6 +103,9 @@ static void verify_ranges(struct passwd *pw, int ranges,
 			exit(EXIT_FAILURE);
 		}
 	}
+
+	if (NULL != subids)
+		subid_index_free(subids);
 }
 
 static void usage(void)
@@ -101,13 +101,37 @@ static bool ingroup(const char *name, struct group *gr)
  *                       membership of a given username
  *                       but check gr itself first
  */
-static /*@null@*/struct group *find_matching_group (const char *name, struct group *gr)
+static /*@null@*/struct group *find_matching_group (const char *name,
+                                                    gid_t primary,
+                                                    struct group *gr)
 {
 	gid_t gid = gr->gr_gid;
 
 	if (ingroup(name, gr))
 		return gr;
 
+#ifdef HAVE_GETGROUPLIST
+	/*
+	 * Ask the name service for the groups of the user first. If the
+	 * GID is not one of them, there is no need to enumerate all the
+	 * groups. The primary group is always reported by getgrouplist().
+	 */
+	if (gid != primary) {
+		int ngroups = 0;
+		int i;
+		gid_t *groups;
+
+		groups = get_grouplist (name, primary, &ngroups);
+		if (NULL != groups) {
+			for (i = 0; (i < ngroups) && (groups[i] != gid); i++);
+			free (groups);
+			if (i == ngroups) {
+				return NULL;
+			}
+		}
+	}
+#endif				/* HAVE_GETGROUPLIST */
+
 	setgrent ();
 	while ((gr = getgrent ()) != NULL) {
 		if (gr->gr_gid != gid) {
@@ -655,7 +679,7 @@ int main (int argc, char **argv)
 	 * membership of the current user.
 	 */
 	if (!is_member) {
-		grp = find_matching_group (name, grp);
+		grp = find_matching_group (name, pwd->pw_gid, grp);
 		if (NULL == grp) {
 			/*
 			 * No matching group found. As we already know that
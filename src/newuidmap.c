@@ -48,14 +48,18 @@
 const char *Prog;
 FILE *shadow_logfd = NULL;
 
-static bool verify_range(struct passwd *pw, struct map_range *range)
+static bool verify_range(struct passwd *pw, struct subid_index *idx,
+	struct map_range *range)
 {
 	/* An empty range is invalid */
 	if (range->count == 0)
 		return false;
 
 	/* Test /etc/subuid */
-	if (have_sub_uids(pw->pw_name, range->lower, range->count))
+	if (NULL != idx) {
+		if (subid_index_covers(idx, range->lower, range->count))
+			return true;
+	} else if (have_sub_uids(pw->pw_name, range->lower, range->count))
 		return true;
 
 	/* Allow a process to map its own uid */
@@ -69,11 +73,19 @@ static void verify_ranges(struct passwd *pw, int ranges,
 	struct map_range *mappings)
 {
 	struct map_range *mapping;
+	struct subid_index *subids;
 	int idx;
 
+	/*
+	 * Index the ranges of the caller once, rather than scanning the
+	 * database for each mapping. Without an index, the mappings are
+	 * checked one by one.
+	 */
+	subids = sub_uid_index(pw->pw_name);
+
 	mapping = mappings;
 	for (idx = 0; idx < ranges; idx++, mapping++) {
-		if (!verify_range(pw, mapping)) {
+		if (!verify_range(pw, subids, mapping)) {
 			fprintf(stderr, _( "%s: uid range [%lu-%lu) -> [%lu-%lu) not allowed\n"),
 				Prog,
 				mapping->upper,
@@ -83,6 +95,9 @@ static void verify_ranges(struct passwd *pw, int ranges,
 			exit(EXIT_FAILURE);
 		}
 	}
+
+	if (NULL != subids)
+		subid_index_free(subids);
 }
 
 void usage(void)
@@ -1063,6 +1063,11 @@ int main (int argc, char **argv)
 	int line = 0;
 	uid_t uid;
 	gid_t gid;
+	/* created users, whose login records shall be reset */
+	uid_t *new_uids = NULL;
+	char **new_names = NULL;
+	unsigned int nnew = 0;
+	unsigned int i;
 #ifdef USE_PAM
 	int *lines = NULL;
 	char **usernames = NULL;
@@ -1193,13 +1198,45 @@ int main (int argc, char **argv)
 		 * available user ID is computed and used. After this there
 		 * will at least be a (struct passwd) for the user.
 		 */
-		if (   (NULL == pw)
-		    && (add_user (fields[0], uid, gid) != 0)) {
-			fprintf (stderr,
-			         _("%s: line %d: can't create user\n"),
-			         Prog, line);
-			errors++;
-			continue;
+		if (NULL == pw) {
+			/*
+			 * The login records of the UID are reset, in case
+			 * it belongs to a previously deleted user, unless
+			 * the UID is shared.
+			 */
+			/* local, no need for xgetpwuid */
+			bool new_uid =    (pw_locate_uid (uid) == NULL)
+			               && (getpwuid (uid) == NULL);
+
+			if (add_user (fields[0], uid, gid) != 0) {
+				fprintf (stderr,
+				         _("%s: line %d: can't create user\n"),
+				         Prog, line);
+				errors++;
+				continue;
+			}
+			if (new_uid) {
+				uid_t *uids;
+				char **names;
+
+				uids = realloc (new_uids, sizeof (new_uids[0]) * (nnew + 1));
+				if (NULL != uids) {
+					new_uids = uids;
+				}
+				names = realloc (new_names, sizeof (new_names[0]) * (nnew + 1));
+				if (NULL != names) {
+					new_names = names;
+				}
+				if ((NULL == uids) || (NULL == names)) {
+					fprintf (stderr,
+					         _("%s: failed to allocate memory: %s\n"),
+					         Prog, strerror (errno));
+					fail_exit (EXIT_FAILURE);
+				}
+				new_uids[nnew] = uid;
+				new_names[nnew] = xstrdup (fields[0]);
+				nnew++;
+			}
 		}
 
 		/*
@@ -1341,12 +1378,22 @@ int main (int argc, char **argv)
 
 	close_files ();
 
+	/* Each log is opened once for all the created users */
+	for (i = 0; i < nnew; i++) {
+		faillog_reset (new_uids[i]);
+		lastlog_reset (new_uids[i]);
+		tallylog_reset (new_uids[i], new_names[i]);
+		free (new_names[i]);
+	}
+	log_reset_close ();
+	free (new_uids);
+	free (new_names);
+
 	nscd_flush_cache ("passwd");
 	nscd_flush_cache ("group");
 	sssd_flush_cache (SSSD_DB_PASSWD | SSSD_DB_GROUP);
 
 #ifdef USE_PAM
-	unsigned int i;
 	/* Now update the passwords using PAM */
 	for (i = 0; i < nusers; i++) {
 		if (do_pam_passwd_non_interactive ("newusers", usernames[i], passwords[i]) != 0) {
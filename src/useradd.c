@@ -51,7 +51,6 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
-#include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 #include "chkname.h"
@@ -86,12 +85,6 @@
 #define USER_DEFAULTS_FILE "/etc/default/useradd"
 #define NEW_USER_FILE "/etc/default/nuaddXXXXXX"
 #endif
-/*
- * Needed for MkLinux DR1/2/2.1 - J.
- */
-#ifndef LASTLOG_FILE
-#define LASTLOG_FILE "/var/log/lastlog"
-#endif
 /*
  * Global variables
  */
@@ -231,9 +224,6 @@ static void unlock_group_files (void);
 static void open_files (void);
 static void open_group_files (void);
 static void open_shadow (void);
-static void faillog_reset (uid_t);
-static void lastlog_reset (uid_t);
-static void tallylog_reset (const char *);
 static void usr_update (unsigned long subuid_count, unsigned long subgid_count);
 static void create_home (void);
 static void create_mail (void);
@@ -1985,133 +1975,6 @@ static void grp_add (void)
 	do_grp_update = true;
 }
 
-static void faillog_reset (uid_t uid)
-{
-	struct faillog fl;
-	int fd;
-	off_t offset_uid = (off_t) (sizeof fl) * uid;
-
-	if (access (FAILLOG_FILE, F_OK) != 0) {
-		return;
-	}
-
-	memzero (&fl, sizeof (fl));
-
-	fd = open (FAILLOG_FILE, O_RDWR);
-	if (-1 == fd) {
-		fprintf (stderr,
-		         _("%s: failed to open the faillog file for UID %lu: %s\n"),
-		         Prog, (unsigned long) uid, strerror (errno));
-		SYSLOG ((LOG_WARN, "failed to open the faillog file for UID %lu", (unsigned long) uid));
-		return;
-	}
-	if (   (lseek (fd, offset_uid, SEEK_SET) != offset_uid)
-	    || (write (fd, &fl, sizeof (fl)) != (ssize_t) sizeof (fl))
-	    || (fsync (fd) != 0)) {
-		fprintf (stderr,
-		         _("%s: failed to reset the faillog entry of UID %lu: %s\n"),
-		         Prog, (unsigned long) uid, strerror (errno));
-		SYSLOG ((LOG_WARN, "failed to reset the faillog entry of UID %lu", (unsigned long) uid));
-	}
-	if (close (fd) != 0) {
-		fprintf (stderr,
-		         _("%s: failed to close the faillog file for UID %lu: %s\n"),
-		         Prog, (unsigned long) uid, strerror (errno));
-		SYSLOG ((LOG_WARN, "failed to close the faillog file for UID %lu", (unsigned long) uid));
-	}
-}
-
-static void lastlog_reset (uid_t uid)
-{
-	struct lastlog ll;
-	int fd;
-	off_t offset_uid = (off_t) (sizeof ll) * uid;
-	uid_t max_uid;
-
-	if (access (LASTLOG_FILE, F_OK) != 0) {
-		return;
-	}
-
-	max_uid = (uid_t) getdef_ulong ("LASTLOG_UID_MAX", 0xFFFFFFFFUL);
-	if (uid > max_uid) {
-		/* do not touch lastlog for large uids */
-		return;
-	}
-
-	memzero (&ll, sizeof (ll));
-
-	fd = open (LASTLOG_FILE, O_RDWR);
-	if (-1 == fd) {
-		fprintf (stderr,
-		         _("%s: failed to open the lastlog file for UID %lu: %s\n"),
-		         Prog, (unsigned long) uid, strerror (errno));
-		SYSLOG ((LOG_WARN, "failed to open the lastlog file for UID %lu", (unsigned long) uid));
-		return;
-	}
-	if (   (lseek (fd, offset_uid, SEEK_SET) != offset_uid)
-	    || (write (fd, &ll, sizeof (ll)) != (ssize_t) sizeof (ll))
-	    || (fsync (fd) != 0)) {
-		fprintf (stderr,
-		         _("%s: failed to reset the lastlog entry of UID %lu: %s\n"),
-		         Prog, (unsigned long) uid, strerror (errno));
-		SYSLOG ((LOG_WARN, "failed to reset the lastlog entry of UID %lu", (unsigned long) uid));
-		/* continue */
-	}
-	if (close (fd) != 0) {
-		fprintf (stderr,
-		         _("%s: failed to close the lastlog file for UID %lu: %s\n"),
-		         Prog, (unsigned long) uid, strerror (errno));
-		SYSLOG ((LOG_WARN, "failed to close the lastlog file for UID %lu", (unsigned long) uid));
-		/* continue */
-	}
-}
-
-static void tallylog_reset (const char *user_name)
-{
-	const char pam_tally2[] = "/sbin/pam_tally2";
-	const char *pname;
-	pid_t childpid;
-	int failed;
-	int status;
-
-	if (access(pam_tally2, X_OK) == -1)
-		return;
-
-	failed = 0;
-	switch (childpid = fork())
-	{
-	case -1: /* error */
-		failed = 1;
-		break;
-	case 0: /* child */
-		pname = strrchr(pam_tally2, '/');
-		if (pname == NULL)
-			pname = pam_tally2;
-		else
-			pname++;        /* Skip the '/' */
-		execl(pam_tally2, pname, "--user", user_name, "--reset", "--quiet", NULL);
-		/* If we come here, something has gone terribly wrong */
-		perror(pam_tally2);
-		exit(42);       /* don't continue, we now have 2 processes running! */
-		/* NOTREACHED */
-		break;
-	default: /* parent */
-		if (waitpid(childpid, &status, 0) == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
-			failed = 1;
-		break;
-	}
-
-	if (failed)
-	{
-		fprintf (stderr,
-		         _("%s: failed to reset the tallylog entry of user \"%s\"\n"),
-		         Prog, user_name);
-		SYSLOG ((LOG_WARN, "failed to reset the tallylog entry of user \"%s\"", user_name));
-	}
-
-	return;
-}
-
 /*
  * usr_update - create the user entries
  *
@@ -2676,14 +2539,10 @@ int main (int argc, char **argv)
 	nscd_flush_cache ("group");
 	sssd_flush_cache (SSSD_DB_PASSWD | SSSD_DB_GROUP);
 
-	/*
-	 * tallylog_reset needs to be able to lookup
-	 * a valid existing user name,
-	 * so we cannot call it before close_files()
-	 */
-	if (!lflg && getpwuid (user_id) != NULL) {
-		tallylog_reset (user_name);
+	if (!lflg) {
+		tallylog_reset (user_id, user_name);
 	}
+	log_reset_close ();
 
 #ifdef WITH_SELINUX
 	if (Zflg) {
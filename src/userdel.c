@@ -180,33 +180,31 @@ static void usage (int status)
  */
 static void update_groups (void)
 {
-	const struct group *grp;
+	const struct group **groups;
 	struct group *ngrp;
+	size_t i;
 
 #ifdef	SHADOWGRP
-	const struct sgrp *sgrp;
+	const struct sgrp **sgroups;
 	struct sgrp *nsgrp;
 #endif				/* SHADOWGRP */
 
 	/*
-	 * Scan through the entire group file looking for the groups that
-	 * the user is a member of.
+	 * Get the groups that the user is a member of.
 	 */
-	for (gr_rewind (), grp = gr_next (); NULL != grp; grp = gr_next ()) {
-
-		/*
-		 * See if the user specified this group as one of their
-		 * concurrent groups.
-		 */
-		if (!is_on_list (grp->gr_mem, user_name)) {
-			continue;
-		}
-
+	groups = gr_member_of (user_name);
+	if (NULL == groups) {
+		fprintf (stderr,
+		         _("%s: Out of memory. Cannot update %s.\n"),
+		         Prog, gr_dbname ());
+		exit (13);	/* XXX */
+	}
+	for (i = 0; NULL != groups[i]; i++) {
 		/*
 		 * Delete the username from the list of group members and
 		 * update the group entry to reflect the change.
 		 */
-		ngrp = __gr_dup (grp);
+		ngrp = __gr_dup (groups[i]);
 		if (NULL == ngrp) {
 			fprintf (stderr,
 			         _("%s: Out of memory. Cannot update %s.\n"),
@@ -233,6 +231,7 @@ static void update_groups (void)
 		SYSLOG ((LOG_INFO, "delete '%s' from group '%s'\n",
 			 user_name, ngrp->gr_name));
 	}
+	free (groups);
 
 	if (getdef_bool ("USERGROUPS_ENAB")) {
 		remove_usergroup ();
@@ -244,27 +243,24 @@ static void update_groups (void)
 	}
 
 	/*
-	 * Scan through the entire shadow group file looking for the groups
-	 * that the user is a member of. Both the administrative list and
-	 * the ordinary membership list is checked.
+	 * Get the shadow groups that the user is a member of. Both the
+	 * administrative list and the ordinary membership list are
+	 * checked.
 	 */
-	for (sgr_rewind (), sgrp = sgr_next ();
-	     NULL != sgrp;
-	     sgrp = sgr_next ()) {
+	sgroups = sgr_member_of (user_name);
+	if (NULL == sgroups) {
+		fprintf (stderr,
+		         _("%s: Out of memory. Cannot update %s.\n"),
+		         Prog, sgr_dbname ());
+		exit (13);	/* XXX */
+	}
+	for (i = 0; NULL != sgroups[i]; i++) {
 		bool was_member, was_admin;
 
-		/*
-		 * See if the user specified this group as one of their
-		 * concurrent groups.
-		 */
-		was_member = is_on_list (sgrp->sg_mem, user_name);
-		was_admin = is_on_list (sgrp->sg_adm, user_name);
-
-		if (!was_member && !was_admin) {
-			continue;
-		}
+		was_member = is_on_list (sgroups[i]->sg_mem, user_name);
+		was_admin = is_on_list (sgroups[i]->sg_adm, user_name);
 
-		nsgrp = __sgr_dup (sgrp);
+		nsgrp = __sgr_dup (sgroups[i]);
 		if (NULL == nsgrp) {
 			fprintf (stderr,
 			         _("%s: Out of memory. Cannot update %s.\n"),
@@ -295,6 +291,7 @@ static void update_groups (void)
 		SYSLOG ((LOG_INFO, "delete '%s' from shadow group '%s'\n",
 		         user_name, nsgrp->sg_name));
 	}
+	free (sgroups);
 #endif				/* SHADOWGRP */
 }
 
@@ -638,6 +635,8 @@ static void open_files (void)
 #endif				/* WITH_AUDIT */
 		fail_exit (E_GRP_UPDATE);
 	}
+	/* Not fatal: gr_member_of() scans the file without index */
+	(void) gr_index_members ();
 #ifdef	SHADOWGRP
 	if (is_shadow_grp) {
 		if (sgr_lock () == 0) {
@@ -664,6 +663,7 @@ static void open_files (void)
 #endif				/* WITH_AUDIT */
 			fail_exit (E_GRP_UPDATE);
 		}
+		(void) sgr_index_members ();
 	}
 #endif				/* SHADOWGRP */
 #ifdef ENABLE_SUBIDS
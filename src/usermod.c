@@ -724,21 +724,88 @@ static /*@noreturn@*/void fail_exit (int code)
 }
 
 
+/*
+ * groups_to_update - list the groups which may need an update
+ *
+ *	These are the groups the user is a member of, and the groups
+ *	given with -G. The returned array is NULL terminated.
+ */
+static /*@only@*/const struct group **groups_to_update (void)
+{
+	const struct group **member_of;
+	const struct group **groups;
+	struct memberset *names;
+	size_t n, i;
+
+	member_of = gr_member_of (user_name);
+	names = memberset_new (NULL);
+	if ((NULL == member_of) || (NULL == names)) {
+		fprintf (stderr,
+		         _("%s: Out of memory. Cannot update %s.\n"),
+		         Prog, gr_dbname ());
+		fail_exit (E_GRP_UPDATE);
+	}
+
+	for (n = 0; NULL != member_of[n]; n++) {
+		if (memberset_add (names, member_of[n]->gr_name) == -1) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, gr_dbname ());
+			fail_exit (E_GRP_UPDATE);
+		}
+	}
+	for (i = 0; Gflg && (NULL != user_groups[i]); i++);
+
+	groups = (const struct group **) xmalloc ((n + i + 1) * sizeof *groups);
+	memcpy (groups, member_of, n * sizeof *groups);
+	free (member_of);
+
+	for (i = 0; Gflg && (NULL != user_groups[i]); i++) {
+		const struct group *grp;
+		int added;
+
+		added = memberset_add (names, user_groups[i]);
+		if (-1 == added) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, gr_dbname ());
+			fail_exit (E_GRP_UPDATE);
+		}
+		if (0 == added) {
+			/* Already listed */
+			continue;
+		}
+		grp = gr_locate (user_groups[i]);
+		if (NULL != grp) {
+			groups[n] = grp;
+			n++;
+		}
+	}
+	groups[n] = NULL;
+
+	memberset_free (names);
+	return groups;
+}
+
 static void update_group (void)
 {
 	bool is_member;
 	bool was_member;
 	bool changed;
+	const struct group **groups;
 	const struct group *grp;
 	struct group *ngrp;
+	size_t i;
 
 	changed = false;
 
 	/*
-	 * Scan through the entire group file looking for the groups that
-	 * the user is a member of.
+	 * Only look at the groups that the user is a member of, or
+	 * should become a member of.
 	 */
-	while ((grp = gr_next ()) != NULL) {
+	groups = groups_to_update ();
+	for (i = 0; NULL != groups[i]; i++) {
+		grp = groups[i];
 		/*
 		 * See if the user specified this group as one of their
 		 * concurrent groups.
@@ -825,25 +892,93 @@ static void update_group (void)
 
 		gr_free(ngrp);
 	}
+	free (groups);
 }
 
 #ifdef SHADOWGRP
+/*
+ * sgroups_to_update - list the shadow groups which may need an update
+ *
+ *	These are the shadow groups the user is a member or an
+ *	administrator of, and the groups given with -G. The returned array is NULL terminated.
+ */
+static /*@only@*/const struct sgrp **sgroups_to_update (void)
+{
+	const struct sgrp **member_of;
+	const struct sgrp **groups;
+	struct memberset *names;
+	size_t n, i;
+
+	member_of = sgr_member_of (user_name);
+	names = memberset_new (NULL);
+	if ((NULL == member_of) || (NULL == names)) {
+		fprintf (stderr,
+		         _("%s: Out of memory. Cannot update %s.\n"),
+		         Prog, sgr_dbname ());
+		fail_exit (E_GRP_UPDATE);
+	}
+
+	for (n = 0; NULL != member_of[n]; n++) {
+		if (memberset_add (names, member_of[n]->sg_name) == -1) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, sgr_dbname ());
+			fail_exit (E_GRP_UPDATE);
+		}
+	}
+	for (i = 0; Gflg && (NULL != user_groups[i]); i++);
+
+	groups = (const struct sgrp **) xmalloc ((n + i + 1) * sizeof *groups);
+	memcpy (groups, member_of, n * sizeof *groups);
+	free (member_of);
+
+	for (i = 0; Gflg && (NULL != user_groups[i]); i++) {
+		const struct sgrp *sgrp;
+		int added;
+
+		added = memberset_add (names, user_groups[i]);
+		if (-1 == added) {
+			fprintf (stderr,
+			         _("%s: Out of memory. Cannot update %s.\n"),
+			         Prog, sgr_dbname ());
+			fail_exit (E_GRP_UPDATE);
+		}
+		if (0 == added) {
+			/* Already listed */
+			continue;
+		}
+		sgrp = sgr_locate (user_groups[i]);
+		if (NULL != sgrp) {
+			groups[n] = sgrp;
+			n++;
+		}
+	}
+	groups[n] = NULL;
+
+	memberset_free (names);
+	return groups;
+}
+
 static void update_gshadow (void)
 {
 	bool is_member;
 	bool was_member;
 	bool was_admin;
 	bool changed;
+	const struct sgrp **sgroups;
 	const struct sgrp *sgrp;
 	struct sgrp *nsgrp;
+	size_t i;
 
 	changed = false;
 
 	/*
-	 * Scan through the entire shadow group file looking for the groups
-	 * that the user is a member of.
+	 * Only look at the shadow groups that the user is a member or an
+	 * administrator of, or should become a member of.
 	 */
-	while ((sgrp = sgr_next ()) != NULL) {
+	sgroups = sgroups_to_update ();
+	for (i = 0; NULL != sgroups[i]; i++) {
+		sgrp = sgroups[i];
 
 		/*
 		 * See if the user was a member of this group
@@ -962,6 +1097,7 @@ static void update_gshadow (void)
 
 		free (nsgrp);
 	}
+	free (sgroups);
 }
 #endif				/* SHADOWGRP */
 
@@ -1638,6 +1774,8 @@ static void open_files (void)
 			         Prog, gr_dbname ());
 			fail_exit (E_GRP_UPDATE);
 		}
+		/* Not fatal: gr_member_of() scans the file without index */
+		(void) gr_index_members ();
 #ifdef SHADOWGRP
 		if (is_shadow_grp && (sgr_lock () == 0)) {
 			fprintf (stderr,
@@ -1652,6 +1790,9 @@ static void open_files (void)
 			         Prog, sgr_dbname ());
 			fail_exit (E_GRP_UPDATE);
 		}
+		if (is_shadow_grp) {
+			(void) sgr_index_members ();
+		}
 #endif
 	}
 #ifdef ENABLE_SUBIDS
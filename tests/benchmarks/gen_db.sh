@@ -0,0 +1,99 @@
+#!/bin/sh
+
+# Generate a root directory with synthetic passwd, shadow, group, gshadow,
+# subuid and subgid files of a given number of users, for the benchmarks.
+#
+# Usage: gen_db.sh <root> <users> [<skel files>]
+#
+# Each user has its own group, and every 100 users share a supplementary
+# group. Each user has a 1000 IDs range in /etc/subuid and /etc/subgid.
+
+set -e
+
+if [ $# -lt 2 ]
+then
+	echo "usage: $0 <root> <users> [<skel files>]" >&2
+	exit 1
+fi
+
+root="$1"
+users="$2"
+skel_files="${3:-1000}"
+
+mkdir -p "$root/etc" "$root/home"
+chmod 755 "$root" "$root/etc" "$root/home"
+
+awk -v users="$users" -v etc="$root/etc" '
+BEGIN {
+	passwd = etc "/passwd"
+	shadow = etc "/shadow"
+	group = etc "/group"
+	gshadow = etc "/gshadow"
+	subuid = etc "/subuid"
+	subgid = etc "/subgid"
+	hash = "$6$benchsalt$zKIE5e1W3L3G7Cr8Npj7V1n5Cmue4VNAgxdQnRtJ5Z1kcpWhD6k0B8m4JwDPtiKp4yqxBq2j1uP7aQOXqYqkR."
+
+	print "root:x:0:0:root:/root:/bin/sh" > passwd
+	print "root:" hash ":19000:0:99999:7:::" > shadow
+	print "root:x:0:" > group
+	print "root:*::" > gshadow
+
+	members = ""
+	for (i = 0; i < users; i++) {
+		name = sprintf ("user%07d", i)
+		id = 10000 + i
+		print name ":x:" id ":" id ":Benchmark user " i ":/home/" name ":/bin/sh" > passwd
+		print name ":" hash ":19000:0:99999:7:::" > shadow
+		print name ":x:" id ":" > group
+		print name ":!::" > gshadow
+		print name ":" (100000 + i * 1000) ":1000" > subuid
+		print name ":" (100000 + i * 1000) ":1000" > subgid
+
+		members = (members == "") ? name : members "," name
+		if ((i % 100) == 99 || i == users - 1) {
+			team = sprintf ("team%05d", int (i / 100))
+			print team ":x:" (5000000 + int (i / 100)) ":" members > group
+			print team ":!::" members > gshadow
+			members = ""
+		}
+	}
+}'
+
+chmod 644 "$root/etc/passwd" "$root/etc/group" "$root/etc/subuid" "$root/etc/subgid"
+chmod 600 "$root/etc/shadow" "$root/etc/gshadow"
+
+cat > "$root/etc/login.defs" << EOT
+MAIL_DIR	/var/mail
+PASS_MAX_DAYS	99999
+PASS_MIN_DAYS	0
+PASS_WARN_AGE	7
+UID_MIN		1000
+UID_MAX		4000000
+SYS_UID_MIN	100
+SYS_UID_MAX	999
+GID_MIN		1000
+GID_MAX		6000000
+SYS_GID_MIN	100
+SYS_GID_MAX	999
+SUB_UID_MIN	100000
+SUB_UID_MAX	4000000000
+SUB_UID_COUNT	1000
+SUB_GID_MIN	100000
+SUB_GID_MAX	4000000000
+SUB_GID_COUNT	1000
+CREATE_HOME	no
+UMASK		022
+USERGROUPS_ENAB	yes
+ENCRYPT_METHOD	SHA512
+EOT
+
+# A skeleton of <skel files> files, in directories of 100 files
+mkdir -p "$root/etc/skel"
+i=0
+while [ $i -lt "$skel_files" ]
+do
+	dir="$root/etc/skel/dir$((i / 100))"
+	[ -d "$dir" ] || mkdir "$dir"
+	echo "skeleton file $i" > "$dir/file$i"
+	i=$((i + 1))
+done
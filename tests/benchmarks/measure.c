@@ -0,0 +1,72 @@
+/*
+ * gcc measure.c -o measure
+ * ./measure result.txt command [args...]
+ *
+ * Run a command and append "<wall time in s> <peak RSS in kB> <status>"
+ * to result.txt.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+
+int main (int argc, char **argv)
+{
+	struct timespec start, end;
+	struct rusage ru;
+	FILE *out;
+	pid_t pid;
+	int status;
+	int ret;
+
+	if (argc < 3) {
+		fprintf (stderr, "usage: %s result command [args...]\n", argv[0]);
+		return 2;
+	}
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+	pid = fork ();
+	if (pid < 0) {
+		perror ("fork");
+		return 2;
+	}
+	if (0 == pid) {
+		execvp (argv[2], &argv[2]);
+		fprintf (stderr, "%s: %s\n", argv[2], strerror (errno));
+		_exit (127);
+	}
+	while (wait4 (pid, &status, 0, &ru) < 0) {
+		if (EINTR != errno) {
+			perror ("wait4");
+			return 2;
+		}
+	}
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	if (WIFEXITED (status)) {
+		ret = WEXITSTATUS (status);
+	} else {
+		ret = 128 + WTERMSIG (status);
+	}
+
+	out = fopen (argv[1], "a");
+	if (NULL == out) {
+		perror (argv[1]);
+		return 2;
+	}
+	fprintf (out, "%.3f %ld %d\n",
+	         (double) (end.tv_sec - start.tv_sec)
+	         + (double) (end.tv_nsec - start.tv_nsec) / 1e9,
+	         ru.ru_maxrss, ret);
+	fclose (out);
+
+	return 0;
+}
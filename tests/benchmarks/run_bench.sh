@@ -0,0 +1,105 @@
+#!/bin/sh
+
+# Benchmark the shadow tools on synthetic databases of increasing sizes.
+#
+# Usage: run_bench.sh [<users>...]
+#
+# The tools of the build tree work on a private root directory (with
+# --root or --prefix), so that the system files are never modified.
+# For each tool and size, the wall time, the peak RSS and, if strace is
+# available, the number of system calls are written to results.tsv.
+#
+# Environment:
+#	BATCH		number of users given to newusers and chpasswd (1000)
+#	SKEL_FILES	number of files in the skeleton for useradd -m (1000)
+#	RESULTS		output file (results.tsv)
+#	BUILD_PATH	build tree of the tools (top of the git tree)
+
+set -e
+
+cd $(dirname $0)
+
+build_path="${BUILD_PATH:-$(git rev-parse --show-toplevel)}"
+src="$build_path/src"
+
+sizes="${*:-10000 100000 1000000}"
+batch="${BATCH:-1000}"
+skel_files="${SKEL_FILES:-1000}"
+results="${RESULTS:-results.tsv}"
+
+if [ "$(id -u)" != "0" ]
+then
+	echo "$0: the tools need to be run as root" >&2
+	exit 1
+fi
+
+make -s measure
+
+work=$(mktemp -d /tmp/shadow-bench.XXXXXX)
+trap 'rm -rf "$work"' 0
+
+strace=$(command -v strace || true)
+
+# bench <size> <name> <command>...
+#
+# Run command on a fresh copy of the generated root in $work/root.
+bench ()
+{
+	size="$1"
+	name="$2"
+	shift 2
+
+	rm -rf "$work/root"
+	cp -a "$work/data" "$work/root"
+	rm -f "$work/measure"
+	./measure "$work/measure" "$@" < "$work/root/batch.$name" \
+		> "$work/$name.log" 2>&1
+	read wall rss status < "$work/measure"
+
+	syscalls="-"
+	if [ -n "$strace" ]
+	then
+		rm -rf "$work/root"
+		cp -a "$work/data" "$work/root"
+		"$strace" -f -c -o "$work/strace" "$@" \
+			< "$work/root/batch.$name" > /dev/null 2>&1 || true
+		syscalls=$(awk '$NF == "total" { print $4 }' "$work/strace")
+	fi
+
+	printf "%s\t%s\t%s\t%s\t%s\t%s\n" \
+		"$size" "$name" "$wall" "$rss" "$syscalls" "$status" |
+		tee -a "$results"
+}
+
+printf "users\ttool\twall_s\tmaxrss_kb\tsyscalls\tstatus\n" > "$results"
+
+for size in $sizes
+do
+	rm -rf "$work/data"
+	./gen_db.sh "$work/data" "$size" "$skel_files"
+
+	# Input of the tools. Most tools do not read stdin.
+	for name in pwck grpck useradd useradd-home userdel groupadd
+	do
+		: > "$work/data/batch.$name"
+	done
+	awk -v n="$batch" 'BEGIN {
+		for (i = 0; i < n; i++)
+			printf "new%07d:secret%d:::New user:/home/new%07d:/bin/sh\n", i, i, i
+	}' > "$work/data/batch.newusers"
+	awk -v n="$batch" -v size="$size" 'BEGIN {
+		for (i = 0; i < n && i < size; i++)
+			printf "user%07d:secret%d\n", i, i
+	}' > "$work/data/batch.chpasswd"
+
+	bench "$size" pwck "$src/pwck" -r -R "$work/root"
+	bench "$size" grpck "$src/grpck" -r -R "$work/root"
+	bench "$size" useradd "$src/useradd" -P "$work/root" bench
+	bench "$size" useradd-home "$src/useradd" -P "$work/root" \
+		-m -k "$work/root/etc/skel" bench
+	bench "$size" userdel "$src/userdel" -P "$work/root" user0000000
+	bench "$size" groupadd "$src/groupadd" -P "$work/root" bench
+	bench "$size" newusers "$src/newusers" --root "$work/root" \
+		/batch.newusers
+	bench "$size" chpasswd "$src/chpasswd" -R "$work/root"
+done
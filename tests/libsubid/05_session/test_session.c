@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <subid.h>
+
+const char *Prog = "test_session";
+FILE *shadow_logfd = NULL;
+
+static void fail(const char *msg)
+{
+	printf("FAILED: %s\n", msg);
+	exit(1);
+}
+
+// Check that the ranges of owner are exactly the count first of expected
+static void check_ranges(struct subid_handle *h, const char *owner,
+			 enum subid_type t, const struct subid_range *expected,
+			 int count)
+{
+	struct subid_range *ranges;
+	int i, n;
+
+	n = subid_get_ranges(h, owner, t, &ranges);
+	if (n != count)
+		fail(owner);
+	for (i = 0; i < n; i++) {
+		if (ranges[i].start != expected[i].start ||
+		    ranges[i].count != expected[i].count)
+			fail(owner);
+	}
+	free(ranges);
+}
+
+// Check that the owners of id are exactly the count first of expected
+static void check_owners(struct subid_handle *h, unsigned long id,
+			 enum subid_type t, const uid_t *expected, int count)
+{
+	uid_t *uids;
+	int i, n;
+
+	n = subid_get_owners(h, id, t, &uids);
+	if (n != count)
+		fail("wrong number of owners");
+	for (i = 0; i < n; i++) {
+		if (uids[i] != expected[i])
+			fail("wrong owner");
+	}
+	free(uids);
+}
+
+static void write_file(const char *path, const char *mode, const char *data)
+{
+	FILE *f = fopen(path, mode);
+
+	if (!f || fputs(data, f) == EOF || fclose(f) != 0)
+		fail(path);
+}
+
+int main(void)
+{
+	struct subid_range foo_uids[] = { { 300000, 10000 }, { 500000, 10000 } };
+	struct subid_range foo_gids[] = { { 200000, 10000 } };
+	struct subid_range foo_new[] = { { 700000, 10000 } };
+	struct subid_range foo_edit[] = { { 800000, 10000 } };
+	struct subid_range root_uids[] = { { 500000, 1000 }, { 600000, 1000 } };
+	uid_t foo = 1000, root = 0;
+	uid_t root_foo[] = { 0, 1000 };
+	struct subid_handle *h;
+
+	h = subid_open();
+	if (!h)
+		fail("subid_open");
+
+	printf("Ranges of a session...");
+	check_ranges(h, "foo", ID_TYPE_UID, foo_uids, 2);
+	check_ranges(h, "foo", ID_TYPE_GID, foo_gids, 1);
+	check_ranges(h, "root", ID_TYPE_UID, root_uids, 1);
+	check_ranges(h, "nobody", ID_TYPE_UID, NULL, 0);
+	printf("OK\n");
+
+	printf("Owners of a session...");
+	check_owners(h, 300000, ID_TYPE_UID, &foo, 1);
+	check_owners(h, 309999, ID_TYPE_UID, &foo, 1);
+	check_owners(h, 310000, ID_TYPE_UID, NULL, 0);
+	check_owners(h, 500000, ID_TYPE_UID, root_foo, 2);
+	check_owners(h, 200000, ID_TYPE_GID, &foo, 1);
+	check_owners(h, 300000, ID_TYPE_GID, NULL, 0);
+	printf("OK\n");
+
+	printf("An empty range owns no ID...");
+	check_owners(h, 0, ID_TYPE_UID, NULL, 0);
+	check_owners(h, 1, ID_TYPE_UID, NULL, 0);
+	check_owners(h, 4294967295UL, ID_TYPE_UID, NULL, 0);
+	printf("OK\n");
+
+	printf("A range appended to the file is seen...");
+	write_file("/etc/subuid", "a", "root:600000:1000\n");
+	check_ranges(h, "root", ID_TYPE_UID, root_uids, 2);
+	check_owners(h, 600999, ID_TYPE_UID, &root, 1);
+	check_owners(h, 300000, ID_TYPE_UID, &foo, 1);
+	printf("OK\n");
+
+	printf("A replaced file is seen...");
+	write_file("/etc/subuid.new", "w", "foo:700000:10000\n");
+	if (rename("/etc/subuid.new", "/etc/subuid") != 0)
+		fail("rename");
+	check_ranges(h, "foo", ID_TYPE_UID, foo_new, 1);
+	check_ranges(h, "root", ID_TYPE_UID, NULL, 0);
+	check_owners(h, 300000, ID_TYPE_UID, NULL, 0);
+	check_owners(h, 700000, ID_TYPE_UID, &foo, 1);
+	check_ranges(h, "foo", ID_TYPE_GID, foo_gids, 1);
+	printf("OK\n");
+
+	printf("A file rewritten in place with the same size is seen...");
+	write_file("/etc/subuid", "r+", "foo:800000:10000\n");
+	check_ranges(h, "foo", ID_TYPE_UID, foo_edit, 1);
+	check_owners(h, 700000, ID_TYPE_UID, NULL, 0);
+	check_owners(h, 800000, ID_TYPE_UID, &foo, 1);
+	printf("OK\n");
+
+	printf("A removed file is an empty database...");
+	if (unlink("/etc/subuid") != 0)
+		fail("unlink");
+	check_ranges(h, "foo", ID_TYPE_UID, NULL, 0);
+	check_owners(h, 800000, ID_TYPE_UID, NULL, 0);
+	check_owners(h, 200000, ID_TYPE_GID, &foo, 1);
+	printf("OK\n");
+
+	subid_close(h);
+	exit(0);
+}
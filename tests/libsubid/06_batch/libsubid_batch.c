@@ -0,0 +1,146 @@
+#include <sys/types.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <subid.h>
+#include <string.h>
+
+// A subid module with the ranges below, for both subuids and subgids.
+// Built with WITH_BATCH, it provides the optional batch queries, and its
+// queries of a single user or ID fail, so that the tests check that the
+// batch queries are used.
+
+static const struct {
+	const char *owner;
+	uid_t uid;
+	unsigned long start;
+	unsigned long count;
+} db[] = {
+	{ "user1", 1001, 100000, 65536 },
+	{ "user2", 1002, 200000, 1000 },
+	{ "user2", 1002, 300000, 1000 },
+};
+#define NDB (sizeof(db) / sizeof(db[0]))
+
+enum subid_status shadow_subid_has_range(const char *owner, unsigned long start, unsigned long count, enum subid_type t, bool *result)
+{
+	size_t i;
+
+	*result = false;
+	for (i = 0; i < NDB; i++) {
+		if (strcmp(owner, db[i].owner) == 0 &&
+		    start >= db[i].start &&
+		    start + count <= db[i].start + db[i].count)
+			*result = true;
+	}
+	return SUBID_STATUS_SUCCESS;
+}
+
+enum subid_status shadow_subid_list_owner_ranges(const char *owner, enum subid_type id_type, struct subid_range **ranges, int *count)
+{
+	size_t i;
+
+	*ranges = NULL;
+	*count = 0;
+#ifdef WITH_BATCH
+	return SUBID_STATUS_ERROR;
+#endif
+	if (strcmp(owner, "error") == 0)
+		return SUBID_STATUS_ERROR;
+	*ranges = malloc(NDB * sizeof(**ranges));
+	if (!*ranges)
+		return SUBID_STATUS_ERROR;
+	for (i = 0; i < NDB; i++) {
+		if (strcmp(owner, db[i].owner) != 0)
+			continue;
+		(*ranges)[*count].start = db[i].start;
+		(*ranges)[*count].count = db[i].count;
+		(*count)++;
+	}
+	return SUBID_STATUS_SUCCESS;
+}
+
+enum subid_status shadow_subid_find_subid_owners(unsigned long id, enum subid_type id_type, uid_t **uids, int *count)
+{
+	size_t i;
+
+	*uids = NULL;
+	*count = 0;
+#ifdef WITH_BATCH
+	return SUBID_STATUS_ERROR;
+#endif
+	*uids = malloc(NDB * sizeof(**uids));
+	if (!*uids)
+		return SUBID_STATUS_ERROR;
+	for (i = 0; i < NDB; i++) {
+		if (id >= db[i].start && id - db[i].start < db[i].count)
+			(*uids)[(*count)++] = db[i].uid;
+	}
+	return SUBID_STATUS_SUCCESS;
+}
+
+#ifdef WITH_BATCH
+enum subid_status shadow_subid_list_owners_ranges(const char *const *owners, size_t n, enum subid_type id_type, struct subordinate_range **ranges, int *count)
+{
+	size_t i, j;
+
+	*ranges = NULL;
+	*count = 0;
+	for (i = 0; i < n; i++) {
+		if (strcmp(owners[i], "error") == 0)
+			return SUBID_STATUS_ERROR;
+	}
+	*ranges = malloc((n * NDB + 1) * sizeof(**ranges));
+	if (!*ranges)
+		return SUBID_STATUS_ERROR;
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < NDB; j++) {
+			if (strcmp(owners[i], db[j].owner) != 0)
+				continue;
+			(*ranges)[*count].owner = owners[i];
+			(*ranges)[*count].start = db[j].start;
+			(*ranges)[*count].count = db[j].count;
+			(*count)++;
+		}
+	}
+	return SUBID_STATUS_SUCCESS;
+}
+
+enum subid_status shadow_subid_find_ids_owners(const unsigned long *ids, size_t n, enum subid_type id_type, struct subid_owner **owners, int *count)
+{
+	size_t i, j;
+
+	*count = 0;
+	*owners = malloc((n * NDB + 1) * sizeof(**owners));
+	if (!*owners)
+		return SUBID_STATUS_ERROR;
+	for (i = 0; i < n; i++) {
+		for (j = 0; j < NDB; j++) {
+			if (ids[i] < db[j].start || ids[i] - db[j].start >= db[j].count)
+				continue;
+			(*owners)[*count].id = ids[i];
+			(*owners)[*count].owner = db[j].uid;
+			(*count)++;
+		}
+	}
+	return SUBID_STATUS_SUCCESS;
+}
+
+enum subid_status shadow_subid_list_all_ranges(enum subid_type id_type, struct subordinate_range **ranges, int *count)
+{
+	size_t i;
+
+	*count = 0;
+	*ranges = malloc(NDB * sizeof(**ranges));
+	if (!*ranges)
+		return SUBID_STATUS_ERROR;
+	for (i = 0; i < NDB; i++) {
+		(*ranges)[i].owner = strdup(db[i].owner);
+		if (!(*ranges)[i].owner)
+			return SUBID_STATUS_ERROR;
+		(*ranges)[i].start = db[i].start;
+		(*ranges)[i].count = db[i].count;
+		(*count)++;
+	}
+	return SUBID_STATUS_SUCCESS;
+}
+#endif
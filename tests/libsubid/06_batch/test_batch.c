@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <subid.h>
+
+const char *Prog = "test_batch";
+FILE *shadow_logfd = NULL;
+
+struct expected_range {
+	int owner;		// index in owners
+	unsigned long start;
+	unsigned long count;
+};
+
+static const char *const owners[] = { "user2", "nobody", "user1" };
+static const unsigned long ids[] = { 300500, 5, 100000, 200999 };
+
+static void fail(const char *msg)
+{
+	printf("FAILED: %s\n", msg);
+	exit(1);
+}
+
+static void check_ranges_batch(struct subid_handle *h,
+			       const struct expected_range *expected, int count)
+{
+	struct subordinate_range *ranges;
+	int i, n;
+
+	n = subid_get_ranges_batch(h, owners, 3, ID_TYPE_UID, &ranges);
+	if (n != count)
+		fail("wrong number of ranges");
+	for (i = 0; i < n; i++) {
+		if (ranges[i].owner != owners[expected[i].owner] ||
+		    ranges[i].start != expected[i].start ||
+		    ranges[i].count != expected[i].count)
+			fail("wrong range");
+	}
+	free(ranges);
+}
+
+static void check_owners_batch(struct subid_handle *h,
+			       const struct subid_owner *expected, int count)
+{
+	struct subid_owner *pairs;
+	int i, n;
+
+	n = subid_get_owners_batch(h, ids, 4, ID_TYPE_UID, &pairs);
+	if (n != count)
+		fail("wrong number of owners");
+	for (i = 0; i < n; i++) {
+		if (pairs[i].id != expected[i].id ||
+		    pairs[i].owner != expected[i].owner)
+			fail("wrong owner");
+	}
+	free(pairs);
+}
+
+static void check_all_ranges(struct subid_handle *h,
+			     const struct subordinate_range *expected, int count)
+{
+	struct subordinate_range *ranges;
+	int i, n;
+
+	n = subid_list_all_ranges(h, ID_TYPE_UID, &ranges);
+	if (n != count)
+		fail("wrong number of ranges");
+	for (i = 0; i < n; i++) {
+		if (strcmp(ranges[i].owner, expected[i].owner) != 0 ||
+		    ranges[i].start != expected[i].start ||
+		    ranges[i].count != expected[i].count)
+			fail("wrong range");
+	}
+	free(ranges);
+}
+
+// /etc/subuid and /etc/subgid of config/etc
+static void test_files(struct subid_handle *h)
+{
+	struct expected_range ranges[] = {
+		{ 0, 200000, 1000 }, { 0, 300000, 1000 }, { 2, 100000, 65536 },
+	};
+	struct subid_owner pairs[] = {
+		{ 300500, 1002 }, { 100000, 1001 }, { 100000, 0 }, { 200999, 1002 },
+	};
+	struct subordinate_range all[] = {
+		{ "user2", 200000, 1000 }, { "user1", 100000, 65536 },
+		{ "zero", 0, 0 }, { "user2", 300000, 1000 },
+		{ "root", 100000, 1000 },
+	};
+	struct subordinate_range *gid_ranges;
+
+	printf("Ranges of several users...");
+	check_ranges_batch(h, ranges, 3);
+	if (subid_get_ranges_batch(h, owners, 0, ID_TYPE_UID, &gid_ranges) != 0)
+		fail("no user");
+	free(gid_ranges);
+	if (subid_get_ranges_batch(h, owners, 3, ID_TYPE_GID, &gid_ranges) != 1 ||
+	    gid_ranges[0].owner != owners[2] ||
+	    gid_ranges[0].start != 100000)
+		fail("subgid ranges");
+	free(gid_ranges);
+	printf("OK\n");
+
+	printf("Owners of several IDs...");
+	check_owners_batch(h, pairs, 4);
+	printf("OK\n");
+
+	printf("All the ranges...");
+	check_all_ranges(h, all, 5);
+	printf("OK\n");
+}
+
+// libsubid_batch.so and libsubid_single.so
+static void test_nss(struct subid_handle *h, int with_batch)
+{
+	struct expected_range ranges[] = {
+		{ 0, 200000, 1000 }, { 0, 300000, 1000 }, { 2, 100000, 65536 },
+	};
+	struct subid_owner pairs[] = {
+		{ 300500, 1002 }, { 100000, 1001 }, { 200999, 1002 },
+	};
+	struct subordinate_range all[] = {
+		{ "user1", 100000, 65536 }, { "user2", 200000, 1000 },
+		{ "user2", 300000, 1000 },
+	};
+	const char *const error_owners[] = { "user1", "error" };
+	struct subordinate_range *error_ranges;
+
+	printf("Ranges of several users...");
+	check_ranges_batch(h, ranges, 3);
+	if (subid_get_ranges_batch(h, error_owners, 2, ID_TYPE_UID, &error_ranges) >= 0)
+		fail("module error");
+	printf("OK\n");
+
+	printf("Owners of several IDs...");
+	check_owners_batch(h, pairs, 3);
+	printf("OK\n");
+
+	if (with_batch) {
+		printf("All the ranges...");
+		check_all_ranges(h, all, 3);
+	} else {
+		printf("All the ranges are not listed without list_all_ranges...");
+		check_all_ranges(h, NULL, -1);
+	}
+	printf("OK\n");
+}
+
+int main(int argc, char *argv[])
+{
+	struct subid_handle *h;
+
+	if (argc != 2)
+		exit(1);
+
+	h = subid_open();
+	if (!h)
+		fail("subid_open");
+
+	if (strcmp(argv[1], "files") == 0)
+		test_files(h);
+	else if (strcmp(argv[1], "batch") == 0)
+		test_nss(h, 1);
+	else if (strcmp(argv[1], "single") == 0)
+		test_nss(h, 0);
+	else
+		exit(1);
+
+	subid_close(h);
+	exit(0);
+}
@@ -0,0 +1,423 @@
+/*
+ * Micro-benchmarks of the functions of libshadow and libmisc on the hot
+ * paths of the tools.
+ *
+ * Usage: microbench [<runs> [<benchmark>...]]
+ *
+ * Each benchmark is run <runs> times (10 by default). The mean time per
+ * operation and its standard deviation are reported in ns/op, with the
+ * fastest run.
+ */
+
+#include <config.h>
+
+#ident "$Id$"
+
+#include <sys/types.h>
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "prototypes.h"
+#include "defines.h"
+#include "chkname.h"
+#include "getdef.h"
+#include "pwio.h"
+#ifdef ENABLE_SUBIDS
+#include "subordinateio.h"
+#endif				/* ENABLE_SUBIDS */
+
+const char *Prog;
+FILE *shadow_logfd = NULL;
+
+#define MEMBERS		100
+#define DB_ENTRIES	10000
+
+/*
+ * A benchmark runs n operations and returns the time they took in ns,
+ * so that it can exclude its own setup.
+ */
+struct benchmark {
+	const char *name;
+	unsigned long ops;	/* operations per run */
+	unsigned long long (*run) (unsigned long n);
+};
+
+static char tmpdir[] = "/tmp/microbench.XXXXXX";
+static char passwd_file[sizeof tmpdir + 16];
+static char subuid_file[sizeof tmpdir + 16];
+static char defs_file[sizeof tmpdir + 16];
+
+static char group_line[MEMBERS * 12 + 64];
+static char *members[MEMBERS + 1];
+static struct group group_ent;
+
+static volatile unsigned long sink;
+
+static unsigned long long now_ns (void)
+{
+	struct timespec ts;
+
+	(void) clock_gettime (CLOCK_MONOTONIC, &ts);
+	return (unsigned long long) ts.tv_sec * 1000000000ULL
+	       + (unsigned long long) ts.tv_nsec;
+}
+
+static unsigned long long bench_sgetpwent (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += (NULL != sgetpwent ("user0012345:x:22345:22345:"
+		                            "Benchmark user,,,:"
+		                            "/home/user0012345:/bin/bash"));
+	}
+	return now_ns () - start;
+}
+
+static unsigned long long bench_sgetgrent (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += (NULL != sgetgrent (group_line));
+	}
+	return now_ns () - start;
+}
+
+static unsigned long long bench_sgetspent (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += (NULL != sgetspent ("user0012345:$6$benchsalt$zKIE5e1W3L"
+		                            "3G7Cr8Npj7V1n5Cmue4VNAgxdQnRtJ5Z1kcp"
+		                            "WhD6k0B8m4JwDPtiKp4yqxBq2j1uP7aQOXqY"
+		                            "qkR.:19000:0:99999:7:::"));
+	}
+	return now_ns () - start;
+}
+
+static unsigned long long bench_gr_dup (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		struct group *gr = __gr_dup (&group_ent);
+
+		if (NULL != gr) {
+			gr_free (gr);
+			sink++;
+		}
+	}
+	return now_ns () - start;
+}
+
+/* One operation is the addition of one member to a list */
+static unsigned long long bench_add_list (unsigned long n)
+{
+	unsigned long long elapsed = 0;
+	unsigned long i;
+
+	for (i = 0; i < n; i += MEMBERS) {
+		unsigned long long start;
+		char **list;
+		int j;
+
+		list = (char **) xmalloc (sizeof (char *));
+		list[0] = NULL;
+		start = now_ns ();
+		for (j = 0; j < MEMBERS; j++) {
+			list = add_list (list, members[j]);
+		}
+		elapsed += now_ns () - start;
+		for (j = 0; NULL != list[j]; j++) {
+			free (list[j]);
+		}
+		free (list);
+	}
+	return elapsed;
+}
+
+/* Look for the last member of a list of MEMBERS members */
+static unsigned long long bench_is_on_list (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += is_on_list (members, members[MEMBERS - 1]);
+	}
+	return now_ns () - start;
+}
+
+/* One operation is the sort of a passwd database of DB_ENTRIES users */
+static unsigned long long bench_commonio_sort (unsigned long n)
+{
+	unsigned long long elapsed = 0;
+	unsigned long i;
+
+	(void) pw_setdbname (passwd_file);
+	for (i = 0; i < n; i++) {
+		unsigned long long start;
+
+		if (pw_open (O_RDONLY) == 0) {
+			fprintf (stderr, "%s: cannot open %s\n", Prog, passwd_file);
+			exit (EXIT_FAILURE);
+		}
+		start = now_ns ();
+		(void) pw_sort ();
+		elapsed += now_ns () - start;
+		(void) pw_close ();
+	}
+	return elapsed;
+}
+
+#ifdef ENABLE_SUBIDS
+/*
+ * subordinate_range_cmp() is static. One operation is a search of a free
+ * range in a subuid database of DB_ENTRIES ranges, which sorts the
+ * database with subordinate_range_cmp() and then scans it.
+ */
+static unsigned long long bench_subordinate_range_cmp (unsigned long n)
+{
+	unsigned long long elapsed = 0;
+	unsigned long i;
+
+	(void) sub_uid_setdbname (subuid_file);
+	for (i = 0; i < n; i++) {
+		unsigned long long start;
+
+		if (sub_uid_open (O_RDONLY) == 0) {
+			fprintf (stderr, "%s: cannot open %s\n", Prog, subuid_file);
+			exit (EXIT_FAILURE);
+		}
+		start = now_ns ();
+		sink += sub_uid_find_free_range (100000, 4000000000U, 65536);
+		elapsed += now_ns () - start;
+		(void) sub_uid_close ();
+	}
+	return elapsed;
+}
+#endif				/* ENABLE_SUBIDS */
+
+/* def_find() is static: go through getdef_str() */
+static unsigned long long bench_def_find (unsigned long n)
+{
+	unsigned long long start;
+	unsigned long i;
+
+	setdef_config_file (defs_file);
+	(void) getdef_str ("UID_MIN");	/* load the file */
+	start = now_ns ();
+	for (i = 0; i < n; i++) {
+		sink += (NULL != getdef_str ("ENCRYPT_METHOD"));
+	}
+	return now_ns () - start;
+}
+
+/* gensalt() is static: go through crypt_make_salt() */
+static unsigned long long bench_gensalt (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += (NULL != crypt_make_salt ("SHA512", NULL));
+	}
+	return now_ns () - start;
+}
+
+static unsigned long long bench_valid_field (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += valid_field ("Benchmark user,Room 42,+1 555 0100,",
+		                     ":,=\n");
+	}
+	return now_ns () - start;
+}
+
+static unsigned long long bench_is_valid_user_name (unsigned long n)
+{
+	unsigned long long start = now_ns ();
+	unsigned long i;
+
+	for (i = 0; i < n; i++) {
+		sink += is_valid_user_name ("user0012345");
+	}
+	return now_ns () - start;
+}
+
+static const struct benchmark benchmarks[] = {
+	{ "sgetpwent",			1000000,	bench_sgetpwent },
+	{ "sgetgrent",			100000,		bench_sgetgrent },
+	{ "sgetspent",			1000000,	bench_sgetspent },
+	{ "__gr_dup",			100000,		bench_gr_dup },
+	{ "add_list",			100000,		bench_add_list },
+	{ "is_on_list",			1000000,	bench_is_on_list },
+	{ "commonio_sort",		10,		bench_commonio_sort },
+#ifdef ENABLE_SUBIDS
+	{ "subordinate_range_cmp",	10,		bench_subordinate_range_cmp },
+#endif				/* ENABLE_SUBIDS */
+	{ "def_find",			1000000,	bench_def_find },
+	{ "gensalt",			100000,		bench_gensalt },
+	{ "valid_field",		1000000,	bench_valid_field },
+	{ "is_valid_user_name",		1000000,	bench_is_valid_user_name },
+};
+
+static void write_file (const char *path, const char *content)
+{
+	FILE *f = fopen (path, "w");
+
+	if (   (NULL == f)
+	    || (fputs (content, f) == EOF)
+	    || (fclose (f) != 0)) {
+		fprintf (stderr, "%s: cannot write %s\n", Prog, path);
+		exit (EXIT_FAILURE);
+	}
+}
+
+static void bench_setup (void)
+{
+	FILE *pw, *sub;
+	size_t len;
+	int i;
+
+	if (NULL == mkdtemp (tmpdir)) {
+		fprintf (stderr, "%s: cannot create %s\n", Prog, tmpdir);
+		exit (EXIT_FAILURE);
+	}
+	(void) snprintf (passwd_file, sizeof passwd_file, "%s/passwd", tmpdir);
+	(void) snprintf (subuid_file, sizeof subuid_file, "%s/subuid", tmpdir);
+	(void) snprintf (defs_file, sizeof defs_file, "%s/login.defs", tmpdir);
+
+	/* A group of MEMBERS members */
+	len = (size_t) snprintf (group_line, sizeof group_line,
+	                         "bench:x:5000:");
+	for (i = 0; i < MEMBERS; i++) {
+		members[i] = xmalloc (16);
+		(void) snprintf (members[i], 16, "user%07d", i);
+		len += (size_t) snprintf (group_line + len,
+		                          sizeof group_line - len,
+		                          "%s%s", (0 != i) ? "," : "",
+		                          members[i]);
+	}
+	members[MEMBERS] = NULL;
+	group_ent.gr_name = "bench";
+	group_ent.gr_passwd = "x";
+	group_ent.gr_gid = 5000;
+	group_ent.gr_mem = members;
+
+	/* Databases in a pseudo-random order */
+	pw = fopen (passwd_file, "w");
+	sub = fopen (subuid_file, "w");
+	if ((NULL == pw) || (NULL == sub)) {
+		fprintf (stderr, "%s: cannot write in %s\n", Prog, tmpdir);
+		exit (EXIT_FAILURE);
+	}
+	for (i = 0; i < DB_ENTRIES; i++) {
+		unsigned long k = ((unsigned long) i * 7919) % DB_ENTRIES;
+
+		fprintf (pw, "user%07lu:x:%lu:%lu::/home/user%07lu:/bin/sh\n",
+		         k, 10000 + k, 10000 + k, k);
+		fprintf (sub, "user%07lu:%lu:65536\n", k, 100000 + k * 65536);
+	}
+	if ((fclose (pw) != 0) || (fclose (sub) != 0)) {
+		fprintf (stderr, "%s: cannot write in %s\n", Prog, tmpdir);
+		exit (EXIT_FAILURE);
+	}
+
+	write_file (defs_file,
+	            "MAIL_DIR /var/mail\n"
+	            "PASS_MAX_DAYS 99999\n"
+	            "UID_MIN 1000\n"
+	            "UID_MAX 60000\n"
+	            "GID_MIN 1000\n"
+	            "GID_MAX 60000\n"
+	            "UMASK 022\n"
+	            "ENCRYPT_METHOD SHA512\n");
+}
+
+static void bench_cleanup (void)
+{
+	(void) unlink (passwd_file);
+	(void) unlink (subuid_file);
+	(void) unlink (defs_file);
+	(void) rmdir (tmpdir);
+}
+
+static bool selected (const char *name, int argc, char **argv)
+{
+	int i;
+
+	if (argc < 3) {
+		return true;
+	}
+	for (i = 2; i < argc; i++) {
+		if (strcmp (argv[i], name) == 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int main (int argc, char **argv)
+{
+	unsigned long runs = 10;
+	size_t b;
+
+	Prog = Basename (argv[0]);
+	shadow_logfd = stderr;
+
+	if (argc > 1) {
+		runs = strtoul (argv[1], NULL, 10);
+		if (0 == runs) {
+			fprintf (stderr, "Usage: %s [<runs> [<benchmark>...]]\n",
+			         Prog);
+			return EXIT_FAILURE;
+		}
+	}
+
+	bench_setup ();
+	(void) atexit (bench_cleanup);
+
+	printf ("%-24s %14s %12s %14s\n",
+	        "benchmark", "ns/op", "stddev", "min ns/op");
+	for (b = 0; b < sizeof benchmarks / sizeof benchmarks[0]; b++) {
+		const struct benchmark *bm = &benchmarks[b];
+		double sum = 0.0, sum2 = 0.0, min = 0.0;
+		double mean, stddev;
+		unsigned long r;
+
+		if (!selected (bm->name, argc, argv)) {
+			continue;
+		}
+
+		(void) bm->run (bm->ops / 10 + 1);	/* warm up */
+		for (r = 0; r < runs; r++) {
+			double ns = (double) bm->run (bm->ops) / (double) bm->ops;
+
+			sum += ns;
+			sum2 += ns * ns;
+			if ((0 == r) || (ns < min)) {
+				min = ns;
+			}
+		}
+		mean = sum / (double) runs;
+		stddev = sqrt (fabs (sum2 / (double) runs - mean * mean));
+		printf ("%-24s %14.1f %12.1f %14.1f\n",
+		        bm->name, mean, stddev, min);
+	}
+
+	return EXIT_SUCCESS;
+}